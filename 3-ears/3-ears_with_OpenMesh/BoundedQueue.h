@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// First in first out queue between the threads of a pipeline, holding at most capacity items.
+// push() blocks while the queue is full, so a fast producer cannot run ahead of a slow consumer,
+// pop() blocks while it is empty. After close() the items left can still be popped.
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(const size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// Returns false, leaving item untouched, if the queue has been closed.
+	bool push(T &&item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cvNotFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+		if (closed)
+			return false;
+		items.push_back(std::move(item));
+		lock.unlock();
+		cvNotEmpty.notify_one();
+		return true;
+	}
+
+	// Returns false once the queue is closed and empty.
+	bool pop(T &item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cvNotEmpty.wait(lock, [this]() { return closed || ! items.empty(); });
+		if (items.empty())
+			return false;
+		item = std::move(items.front());
+		items.pop_front();
+		lock.unlock();
+		cvNotFull.notify_one();
+		return true;
+	}
+
+	// No more items will be pushed, wakes up all the threads waiting.
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		cvNotFull.notify_all();
+		cvNotEmpty.notify_all();
+	}
+
+private:
+	const size_t			capacity;
+	std::deque<T>			items;
+	std::mutex				mutex;
+	std::condition_variable	cvNotFull;
+	std::condition_variable	cvNotEmpty;
+	bool					closed = false;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Output file written through a large buffer of our own, so the OS sees one write per buffer,
+// and numbers are formatted by std::to_chars, neither locale aware nor going through a stream.
+class BufferedWriter
+{
+public:
+	explicit BufferedWriter(const size_t bufferSize = size_t(1) << 20) : buffer(std::max<size_t>(bufferSize, 64)) {}
+	~BufferedWriter() { close(); }
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	// The file is always written as is, without text mode line end conversion.
+	bool open(const std::string &fileName)
+	{
+		close();
+		file = fopen(fileName.c_str(), "wb");
+		failed = (file == nullptr);
+		return file != nullptr;
+	}
+
+	bool is_open() const { return file != nullptr; }
+
+	// Returns false if any write has failed since open().
+	bool close()
+	{
+		if (file) {
+			flush();
+			if (fclose(file) != 0)
+				failed = true;
+			file = nullptr;
+		}
+		return ! failed;
+	}
+
+	void write(const void *data, const size_t size)
+	{
+		if (used + size > buffer.size()) {
+			flush();
+			if (size > buffer.size()) {
+				writeThrough(data, size);
+				return;
+			}
+		}
+		memcpy(buffer.data() + used, data, size);
+		used += size;
+	}
+
+	void put(const char c)
+	{
+		if (used == buffer.size())
+			flush();
+		buffer[used ++] = c;
+	}
+
+	// Shortest representation which reads back to the same value.
+	template<typename T>
+	void number(const T value)
+	{
+		// Enough for any double in its shortest form.
+		const size_t maxChars = 32;
+		if (used + maxChars > buffer.size())
+			flush();
+		const std::to_chars_result result = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+		used = result.ptr - buffer.data();
+	}
+
+	void flush()
+	{
+		writeThrough(buffer.data(), used);
+		used = 0;
+	}
+
+private:
+	void writeThrough(const void *data, const size_t size)
+	{
+		if (file && size > 0 && fwrite(data, 1, size, file) != size)
+			failed = true;
+	}
+
+	std::vector<char>	buffer;
+	size_t				used   = 0;
+	FILE				*file  = nullptr;
+	bool				failed = false;
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+
+// Index of a mesh item, -1 if invalid. One type per item kind, so that a vertex cannot be passed for a face.
+template<int KIND>
+class CompactHandle
+{
+public:
+	explicit CompactHandle(int idx = -1) : idx_(int32_t(idx)) {}
+
+	int  idx() const		{ return idx_; }
+	bool is_valid() const	{ return idx_ >= 0; }
+	void reset()			{ idx_ = -1; }
+
+	bool operator==(const CompactHandle &h) const	{ return idx_ == h.idx_; }
+	bool operator!=(const CompactHandle &h) const	{ return idx_ != h.idx_; }
+	bool operator< (const CompactHandle &h) const	{ return idx_ <  h.idx_; }
+
+private:
+	int32_t idx_;
+};
+
+// Iterates the handles 0 .. n-1 of one kind.
+template<typename HANDLE>
+class CompactHandleIterator
+{
+public:
+	explicit CompactHandleIterator(int idx) : handle(idx) {}
+
+	const HANDLE& operator*() const		{ return handle; }
+	const HANDLE* operator->() const	{ return &handle; }
+	CompactHandleIterator& operator++()	{ handle = HANDLE(handle.idx() + 1); return *this; }
+	bool operator==(const CompactHandleIterator &it) const { return handle == it.handle; }
+	bool operator!=(const CompactHandleIterator &it) const { return handle != it.handle; }
+
+private:
+	HANDLE handle;
+};
+
+/** Half-edge mesh of a triangulated polygon, a lean alternative to PolyMesh_ArrayKernelT to be used as Kernel::MeshType.
+ *  Offers the subset of the OpenMesh interface used by the ear cutting, FlipDiagonal() and drawMesh(), with the same semantics.
+ *  All items are stored as structures of arrays of 32-bit indices, without status flags or property containers.
+ *  The two halfedges of edge e are 2e and 2e+1, so the opposite halfedge is implicit. The previous halfedges are stored,
+ *  both insert_edge() and FlipDiagonal() need them and walking the loop of a polygonal face to find them would be linear.
+ *  Boundary halfedges have no face.
+ */
+template<typename T>
+class CompactTriMesh
+{
+public:
+	typedef OpenMesh::VectorT<T, 2>		Point;
+	typedef T							Scalar;
+
+	typedef CompactHandle<0>			VertexHandle;
+	typedef CompactHandle<1>			HalfedgeHandle;
+	typedef CompactHandle<2>			EdgeHandle;
+	typedef CompactHandle<3>			FaceHandle;
+
+	typedef CompactHandleIterator<VertexHandle>		VertexIter;
+	typedef CompactHandleIterator<HalfedgeHandle>	HalfedgeIter;
+	typedef CompactHandleIterator<EdgeHandle>		EdgeIter;
+	typedef CompactHandleIterator<FaceHandle>		FaceIter;
+
+	void reserve(const size_t nVertices, const size_t nEdges, const size_t nFaces)
+	{
+		pointX.reserve(nVertices);
+		pointY.reserve(nVertices);
+		vertexHalfedge.reserve(nVertices);
+		halfedgeVertex.reserve(2 * nEdges);
+		halfedgeNext.reserve(2 * nEdges);
+		halfedgePrev.reserve(2 * nEdges);
+		halfedgeFace.reserve(2 * nEdges);
+		faceHalfedge.reserve(nFaces);
+	}
+
+	// Bytes per vertex of a triangulated polygon, which has about one face, two edges and four halfedges per vertex.
+	static size_t bytesPerVertex()
+	{
+		return 2 * sizeof(T) + sizeof(int32_t) + 4 * 4 * sizeof(int32_t) + sizeof(int32_t);
+	}
+
+	// Remove all items, the memory is kept for the next mesh.
+	void clean()
+	{
+		pointX.clear();
+		pointY.clear();
+		vertexHalfedge.clear();
+		halfedgeVertex.clear();
+		halfedgeNext.clear();
+		halfedgePrev.clear();
+		halfedgeFace.clear();
+		faceHalfedge.clear();
+	}
+
+	size_t n_vertices() const	{ return pointX.size(); }
+	size_t n_halfedges() const	{ return halfedgeVertex.size(); }
+	size_t n_edges() const		{ return halfedgeVertex.size() / 2; }
+	size_t n_faces() const		{ return faceHalfedge.size(); }
+
+	VertexIter		vertices_begin() const	{ return VertexIter(0); }
+	VertexIter		vertices_end() const	{ return VertexIter(int(n_vertices())); }
+	HalfedgeIter	halfedges_begin() const	{ return HalfedgeIter(0); }
+	HalfedgeIter	halfedges_end() const	{ return HalfedgeIter(int(n_halfedges())); }
+	EdgeIter		edges_begin() const		{ return EdgeIter(0); }
+	EdgeIter		edges_end() const		{ return EdgeIter(int(n_edges())); }
+	FaceIter		faces_begin() const		{ return FaceIter(0); }
+	FaceIter		faces_end() const		{ return FaceIter(int(n_faces())); }
+
+	VertexHandle vertex_handle(unsigned int i) const	{ return VertexHandle(int(i)); }
+	FaceHandle   face_handle(unsigned int i) const		{ return FaceHandle(int(i)); }
+
+	// Vertices.
+	VertexHandle add_vertex(const Point &p)
+	{
+		pointX.push_back(p[0]);
+		pointY.push_back(p[1]);
+		vertexHalfedge.push_back(-1);
+		return VertexHandle(int(pointX.size()) - 1);
+	}
+	Point point(const VertexHandle vh) const			{ return Point(pointX[vh.idx()], pointY[vh.idx()]); }
+	void set_point(const VertexHandle vh, const Point &p)	{ pointX[vh.idx()] = p[0]; pointY[vh.idx()] = p[1]; }
+
+	HalfedgeHandle halfedge_handle(const VertexHandle vh) const				{ return HalfedgeHandle(vertexHalfedge[vh.idx()]); }
+	void set_halfedge_handle(const VertexHandle vh, const HalfedgeHandle hh)	{ vertexHalfedge[vh.idx()] = hh.idx(); }
+
+	// Halfedges.
+	VertexHandle to_vertex_handle(const HalfedgeHandle hh) const	{ return VertexHandle(halfedgeVertex[hh.idx()]); }
+	VertexHandle from_vertex_handle(const HalfedgeHandle hh) const	{ return VertexHandle(halfedgeVertex[hh.idx() ^ 1]); }
+	void set_vertex_handle(const HalfedgeHandle hh, const VertexHandle vh)	{ halfedgeVertex[hh.idx()] = vh.idx(); }
+
+	HalfedgeHandle opposite_halfedge_handle(const HalfedgeHandle hh) const	{ return HalfedgeHandle(hh.idx() ^ 1); }
+	HalfedgeHandle next_halfedge_handle(const HalfedgeHandle hh) const		{ return HalfedgeHandle(halfedgeNext[hh.idx()]); }
+	HalfedgeHandle prev_halfedge_handle(const HalfedgeHandle hh) const		{ return HalfedgeHandle(halfedgePrev[hh.idx()]); }
+	// Like OpenMesh, also links nhh back to hh.
+	void set_next_halfedge_handle(const HalfedgeHandle hh, const HalfedgeHandle nhh)
+	{
+		halfedgeNext[hh.idx()]  = nhh.idx();
+		halfedgePrev[nhh.idx()] = hh.idx();
+	}
+	void set_prev_halfedge_handle(const HalfedgeHandle hh, const HalfedgeHandle phh)	{ halfedgePrev[hh.idx()] = phh.idx(); }
+
+	FaceHandle face_handle(const HalfedgeHandle hh) const				{ return FaceHandle(halfedgeFace[hh.idx()]); }
+	void set_face_handle(const HalfedgeHandle hh, const FaceHandle fh)	{ halfedgeFace[hh.idx()] = fh.idx(); }
+
+	bool is_boundary(const HalfedgeHandle hh) const	{ return halfedgeFace[hh.idx()] < 0; }
+	bool is_boundary(const EdgeHandle eh) const		{ return halfedgeFace[2 * eh.idx()] < 0 || halfedgeFace[2 * eh.idx() + 1] < 0; }
+
+	// Edges.
+	EdgeHandle edge_handle(const HalfedgeHandle hh) const						{ return EdgeHandle(hh.idx() >> 1); }
+	HalfedgeHandle halfedge_handle(const EdgeHandle eh, const unsigned int i) const	{ return HalfedgeHandle(2 * eh.idx() + int(i)); }
+
+	// Faces.
+	HalfedgeHandle halfedge_handle(const FaceHandle fh) const				{ return HalfedgeHandle(faceHalfedge[fh.idx()]); }
+	void set_halfedge_handle(const FaceHandle fh, const HalfedgeHandle hh)	{ faceHalfedge[fh.idx()] = hh.idx(); }
+
+	/** Add the face of a polygon whose vertices are not used by any face yet, i.e. a polygon with all edges on the boundary.
+	 *  That is all a triangulation of a polygon starts with, adding faces adjacent to others is not supported.
+	 */
+	FaceHandle add_face(const std::vector<VertexHandle> &vertices)
+	{
+		const int n = int(vertices.size());
+		assert(n >= 3);
+		const FaceHandle fh = new_face();
+		const int first = int(halfedgeVertex.size());
+		for (int i = 0; i < n; ++ i) {
+			assert(vertexHalfedge[vertices[i].idx()] < 0);
+			new_edge(vertices[i], vertices[(i + 1) % n]);
+		}
+		// Halfedge first + 2i leads from vertex i to i+1 inside the face, its opposite runs the other way around the boundary.
+		for (int i = 0; i < n; ++ i) {
+			const int inner = first + 2 * i, innerNext = first + 2 * ((i + 1) % n);
+			set_next_halfedge_handle(HalfedgeHandle(inner), HalfedgeHandle(innerNext));
+			set_next_halfedge_handle(HalfedgeHandle(innerNext + 1), HalfedgeHandle(inner + 1));
+			halfedgeFace[inner] = fh.idx();
+			// The outgoing halfedge of a boundary vertex is a boundary one.
+			vertexHalfedge[vertices[(i + 1) % n].idx()] = inner + 1;
+		}
+		set_halfedge_handle(fh, HalfedgeHandle(first));
+		return fh;
+	}
+
+	/** Split a face by a new edge from to(prevHh) to from(nextHh), both halfedges being in the face.
+	 *  As in OpenMesh, the returned halfedge gets a new face, which contains nextHh ... prevHh, and its opposite stays in the old one.
+	 */
+	HalfedgeHandle insert_edge(const HalfedgeHandle prevHh, const HalfedgeHandle nextHh)
+	{
+		assert(face_handle(prevHh) == face_handle(nextHh));
+		assert(next_halfedge_handle(prevHh) != nextHh);
+		const HalfedgeHandle hh0 = new_edge(to_vertex_handle(prevHh), from_vertex_handle(nextHh));
+		const HalfedgeHandle hh1 = opposite_halfedge_handle(hh0);
+		const HalfedgeHandle nextPrevHh = next_halfedge_handle(prevHh);
+		const HalfedgeHandle prevNextHh = prev_halfedge_handle(nextHh);
+		set_next_halfedge_handle(prevHh, hh0);
+		set_next_halfedge_handle(hh0, nextHh);
+		set_next_halfedge_handle(prevNextHh, hh1);
+		set_next_halfedge_handle(hh1, nextPrevHh);
+
+		const FaceHandle oldFh = face_handle(nextHh);
+		const FaceHandle newFh = new_face();
+		set_halfedge_handle(newFh, hh0);
+		for (HalfedgeHandle hh = nextHh; hh != hh0; hh = next_halfedge_handle(hh))
+			set_face_handle(hh, newFh);
+		set_face_handle(hh0, newFh);
+		set_face_handle(hh1, oldFh);
+		if (oldFh.is_valid())
+			set_halfedge_handle(oldFh, hh1);
+		return hh0;
+	}
+
+	// Make the outgoing halfedge of a boundary vertex a boundary one, as OpenMesh expects.
+	void adjust_outgoing_halfedge(const VertexHandle vh)
+	{
+		const HalfedgeHandle hhFirst = halfedge_handle(vh);
+		if (! hhFirst.is_valid())
+			return;
+		HalfedgeHandle hh = hhFirst;
+		do {
+			if (is_boundary(hh)) {
+				set_halfedge_handle(vh, hh);
+				return;
+			}
+			hh = next_halfedge_handle(opposite_halfedge_handle(hh));
+		} while (hh != hhFirst);
+	}
+
+	// New unlinked edge, its first halfedge leads from v0 to v1.
+	HalfedgeHandle new_edge(const VertexHandle v0, const VertexHandle v1)
+	{
+		const int hh = int(halfedgeVertex.size());
+		halfedgeVertex.push_back(v1.idx());
+		halfedgeVertex.push_back(v0.idx());
+		halfedgeNext.insert(halfedgeNext.end(), 2, -1);
+		halfedgePrev.insert(halfedgePrev.end(), 2, -1);
+		halfedgeFace.insert(halfedgeFace.end(), 2, -1);
+		return HalfedgeHandle(hh);
+	}
+
+	// New face without halfedges.
+	FaceHandle new_face()
+	{
+		faceHalfedge.push_back(-1);
+		return FaceHandle(int(faceHalfedge.size()) - 1);
+	}
+
+private:
+
+	std::vector<T>			pointX, pointY;
+	std::vector<int32_t>	vertexHalfedge;
+	std::vector<int32_t>	halfedgeVertex, halfedgeNext, halfedgePrev, halfedgeFace;
+	std::vector<int32_t>	faceHalfedge;
+};
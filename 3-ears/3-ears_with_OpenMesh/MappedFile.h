@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only view of a whole file mapped into memory.
+// The pages are read by the OS on first access, so nothing is copied into a buffer of our own.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	explicit MappedFile(const std::string &path) { open(path); }
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file cannot be opened or mapped. An empty file opens with size() == 0.
+	bool open(const std::string &path)
+	{
+		close();
+#ifdef _WIN32
+		hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (! GetFileSizeEx(hFile, &fileSize)) {
+			close();
+			return false;
+		}
+		nBytes = size_t(fileSize.QuadPart);
+		if (nBytes > 0) {
+			hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (hMapping == nullptr) {
+				close();
+				return false;
+			}
+			bytes = static_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+			if (bytes == nullptr) {
+				close();
+				return false;
+			}
+		}
+#else
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close();
+			return false;
+		}
+		nBytes = size_t(st.st_size);
+		if (nBytes > 0) {
+			void *addr = mmap(nullptr, nBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr == MAP_FAILED) {
+				close();
+				return false;
+			}
+			bytes = static_cast<const char*>(addr);
+			madvise(addr, nBytes, MADV_SEQUENTIAL);
+		}
+#endif
+		opened = true;
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (bytes)
+			UnmapViewOfFile(bytes);
+		if (hMapping)
+			CloseHandle(hMapping);
+		if (hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(hFile);
+		hMapping = nullptr;
+		hFile    = INVALID_HANDLE_VALUE;
+#else
+		if (bytes)
+			munmap(const_cast<char*>(bytes), nBytes);
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+#endif
+		bytes  = nullptr;
+		nBytes = 0;
+		opened = false;
+	}
+
+	bool		is_open() const { return opened; }
+	const char*	data()    const { return bytes ? bytes : ""; }
+	size_t		size()    const { return nBytes; }
+	const char*	begin()   const { return data(); }
+	const char*	end()     const { return data() + nBytes; }
+
+private:
+	const char	*bytes  = nullptr;
+	size_t		 nBytes = 0;
+	bool		 opened = false;
+#ifdef _WIN32
+	HANDLE		 hFile    = INVALID_HANDLE_VALUE;
+	HANDLE		 hMapping = nullptr;
+#else
+	int			 fd = -1;
+#endif
+};
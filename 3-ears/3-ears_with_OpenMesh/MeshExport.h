@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "BufferedWriter.h"
+
+// Exporters of a triangulation in KERNEL::MeshType, i.e. PolyMesh_ArrayKernelT or CompactTriMesh.
+// The vertices keep their indices, the faces are written in the order of the mesh, each starting at the target
+// of its halfedge_handle(). All of them return 0, or -1 after reporting to cerr.
+
+// Vertex indices of face fh, at most maxVertices of them are stored to v. Returns the number of vertices of the face.
+template<typename MeshType>
+int faceVertexIndices(const MeshType &mesh, const typename MeshType::FaceHandle fh, uint32_t *v, const int maxVertices)
+{
+	const typename MeshType::HalfedgeHandle hhFirst = mesh.halfedge_handle(fh);
+	typename MeshType::HalfedgeHandle hh = hhFirst;
+	int n = 0;
+	do {
+		if (n < maxVertices)
+			v[n] = uint32_t(mesh.to_vertex_handle(hh).idx());
+		++ n;
+		hh = mesh.next_halfedge_handle(hh);
+	} while (hh != hhFirst);
+	return n;
+}
+
+// Raw index buffer, three uint32_t per triangle in the byte order of the machine, as StreamingEarClipper writes it.
+// Fails on a face which is not a triangle.
+template<typename MeshType>
+int writeTriangleIndices(const std::string &fileName, const MeshType &mesh)
+{
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	for (size_t i = 0; i < mesh.n_faces(); ++ i) {
+		uint32_t v[3];
+		if (faceVertexIndices(mesh, mesh.face_handle((unsigned int)i), v, 3) != 3) {
+			std::cerr << "Error: " << fileName << ": face " << i << " is not a triangle" << std::endl;
+			return -1;
+		}
+		out.write(v, sizeof(v));
+	}
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Binary PLY in the byte order of the machine, with z = 0. A face may have up to 255 vertices.
+template<typename MeshType>
+int writePly(const std::string &fileName, const MeshType &mesh)
+{
+	typedef typename MeshType::Point::value_type Scalar;
+
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	const uint16_t one = 1;
+	const bool littleEndian = *reinterpret_cast<const unsigned char*>(&one) == 1;
+	const char *scalarName = (sizeof(Scalar) == sizeof(float)) ? "float" : "double";
+	const std::string header = std::string("ply\n") +
+		"format " + (littleEndian ? "binary_little_endian" : "binary_big_endian") + " 1.0\n" +
+		"element vertex " + std::to_string(mesh.n_vertices()) + "\n" +
+		"property " + scalarName + " x\n" +
+		"property " + scalarName + " y\n" +
+		"property " + scalarName + " z\n" +
+		"element face " + std::to_string(mesh.n_faces()) + "\n" +
+		"property list uchar int vertex_indices\n" +
+		"end_header\n";
+	out.write(header.data(), header.size());
+
+	for (size_t i = 0; i < mesh.n_vertices(); ++ i) {
+		const typename MeshType::Point p = mesh.point(mesh.vertex_handle((unsigned int)i));
+		const Scalar xyz[3] = { p[0], p[1], Scalar(0) };
+		out.write(xyz, sizeof(xyz));
+	}
+	for (size_t i = 0; i < mesh.n_faces(); ++ i) {
+		uint32_t v[255];
+		const int n = faceVertexIndices(mesh, mesh.face_handle((unsigned int)i), v, 255);
+		if (n > 255) {
+			std::cerr << "Error: " << fileName << ": face " << i << " has more than 255 vertices" << std::endl;
+			return -1;
+		}
+		out.put(char(n));
+		out.write(v, n * sizeof(uint32_t));
+	}
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Wavefront OBJ with z = 0, the coordinates in their shortest form which reads back to the same value.
+template<typename MeshType>
+int writeObj(const std::string &fileName, const MeshType &mesh)
+{
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	for (size_t i = 0; i < mesh.n_vertices(); ++ i) {
+		const typename MeshType::Point p = mesh.point(mesh.vertex_handle((unsigned int)i));
+		out.write("v ", 2);
+		out.number(p[0]);
+		out.put(' ');
+		out.number(p[1]);
+		out.write(" 0\n", 3);
+	}
+	for (size_t i = 0; i < mesh.n_faces(); ++ i) {
+		// OBJ counts the vertices from 1.
+		const typename MeshType::HalfedgeHandle hhFirst = mesh.halfedge_handle(mesh.face_handle((unsigned int)i));
+		typename MeshType::HalfedgeHandle hh = hhFirst;
+		out.put('f');
+		do {
+			out.put(' ');
+			out.number(mesh.to_vertex_handle(hh).idx() + 1);
+			hh = mesh.next_halfedge_handle(hh);
+		} while (hh != hhFirst);
+		out.put('\n');
+	}
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Format of the triangulation written by writeMesh().
+enum MeshFormat {
+	MESH_FORMAT_NONE,	// nothing is written
+	MESH_FORMAT_PLY,	// see writePly()
+	MESH_FORMAT_OBJ,	// see writeObj()
+	MESH_FORMAT_TRI,	// see writeTriangleIndices()
+};
+
+inline const char* meshFormatExtension(const MeshFormat format)
+{
+	switch (format) {
+	case MESH_FORMAT_PLY:	return ".ply";
+	case MESH_FORMAT_OBJ:	return ".obj";
+	case MESH_FORMAT_TRI:	return ".tri";
+	default:				return "";
+	}
+}
+
+// Writes the mesh to fileName, which should end by meshFormatExtension(format).
+template<typename MeshType>
+int writeMesh(const std::string &fileName, const MeshType &mesh, const MeshFormat format)
+{
+	switch (format) {
+	case MESH_FORMAT_PLY:	return writePly(fileName, mesh);
+	case MESH_FORMAT_OBJ:	return writeObj(fileName, mesh);
+	case MESH_FORMAT_TRI:	return writeTriangleIndices(fileName, mesh);
+	default:				return 0;
+	}
+}
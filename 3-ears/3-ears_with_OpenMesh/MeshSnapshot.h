@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BufferedWriter.h"
+#include "MappedFile.h"
+
+// Binary snapshot of a mesh (.msnap), e.g. to checkpoint after the ear cutting and to rerun only the flipping:
+// a 64 byte header followed by the raw arrays of the halfedge structure, each starting at a multiple of 8 bytes,
+// all in the byte order of the machine which wrote it:
+//   points				nVertices * 2 scalars
+//   vertex halfedge	nVertices int32, -1 for an isolated vertex
+//   halfedge vertex	2 * nEdges int32, the halfedges 2e and 2e + 1 are the two halves of the edge e
+//   halfedge next		2 * nEdges int32
+//   halfedge face		2 * nEdges int32, -1 on the boundary
+//   face halfedge		nFaces int32
+//   edge constraint	nEdges bytes, 1 for an edge which must not be flipped
+// The previous halfedges are not stored, setting the next ones restores them.
+struct MeshSnapshotHeader
+{
+	char		magic[8];		// "MSNAP" padded by zeros
+	uint32_t	version;		// 1
+	uint32_t	scalarSize;		// 4 for float, 8 for double points
+	uint64_t	nVertices;
+	uint64_t	nEdges;
+	uint64_t	nFaces;
+	uint64_t	reserved[3];
+};
+static_assert(sizeof(MeshSnapshotHeader) == 64, "The arrays are expected to start at byte 64");
+
+inline const char* meshSnapshotMagic() { return "MSNAP\0\0"; }
+
+// Bytes of an array of the snapshot including the padding to 8 bytes.
+inline uint64_t meshSnapshotPadded(const uint64_t bytes) { return (bytes + 7) & ~uint64_t(7); }
+
+/** Saves the mesh to fileName.
+ *  @param[in]  constrained - One flag per edge, the boundary edges are stored as the constraints if not given
+ *  @return 0, or -1 after reporting to cerr
+ */
+template<typename MeshType>
+int saveMeshSnapshot(const std::string &fileName, const MeshType &mesh, const std::vector<char> *constrained = nullptr)
+{
+	typedef typename MeshType::Point::value_type	Scalar;
+	typedef typename MeshType::VertexHandle			VH;
+	typedef typename MeshType::EdgeHandle			EH;
+	typedef typename MeshType::FaceHandle			FH;
+
+	MeshSnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, meshSnapshotMagic(), sizeof(header.magic));
+	header.version		= 1;
+	header.scalarSize	= uint32_t(sizeof(Scalar));
+	header.nVertices	= mesh.n_vertices();
+	header.nEdges		= mesh.n_edges();
+	header.nFaces		= mesh.n_faces();
+	if (constrained && constrained->size() != mesh.n_edges()) {
+		std::cerr << "Error: " << fileName << ": one constraint flag per edge expected" << std::endl;
+		return -1;
+	}
+
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	const char zeros[8] = {};
+	auto pad = [&out, &zeros](const uint64_t bytes) { out.write(zeros, size_t(meshSnapshotPadded(bytes) - bytes)); };
+	const int nVertices = int(mesh.n_vertices()), nEdges = int(mesh.n_edges()), nFaces = int(mesh.n_faces());
+
+	out.write(&header, sizeof(header));
+	for (int i = 0; i < nVertices; ++ i) {
+		const typename MeshType::Point p = mesh.point(VH(i));
+		const Scalar xy[2] = { p[0], p[1] };
+		out.write(xy, sizeof(xy));
+	}
+	for (int i = 0; i < nVertices; ++ i) {
+		const int32_t hh = mesh.halfedge_handle(VH(i)).idx();
+		out.write(&hh, sizeof(hh));
+	}
+	pad(uint64_t(nVertices) * sizeof(int32_t));
+	for (int i = 0; i < nEdges; ++ i)
+		for (unsigned int j = 0; j < 2; ++ j) {
+			const int32_t vh = mesh.to_vertex_handle(mesh.halfedge_handle(EH(i), j)).idx();
+			out.write(&vh, sizeof(vh));
+		}
+	for (int i = 0; i < nEdges; ++ i)
+		for (unsigned int j = 0; j < 2; ++ j) {
+			const int32_t hh = mesh.next_halfedge_handle(mesh.halfedge_handle(EH(i), j)).idx();
+			out.write(&hh, sizeof(hh));
+		}
+	for (int i = 0; i < nEdges; ++ i)
+		for (unsigned int j = 0; j < 2; ++ j) {
+			const int32_t fh = mesh.face_handle(mesh.halfedge_handle(EH(i), j)).idx();
+			out.write(&fh, sizeof(fh));
+		}
+	for (int i = 0; i < nFaces; ++ i) {
+		const int32_t hh = mesh.halfedge_handle(FH(i)).idx();
+		out.write(&hh, sizeof(hh));
+	}
+	pad(uint64_t(nFaces) * sizeof(int32_t));
+	for (int i = 0; i < nEdges; ++ i)
+		out.put(char(constrained ? ((*constrained)[i] != 0) : mesh.is_boundary(EH(i))));
+	pad(uint64_t(nEdges));
+
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+/** Replaces the mesh by the snapshot in fileName. The arrays are read from the memory mapped file and set directly,
+ *  no connectivity is searched for. The handles of all the items are the same as in the saved mesh.
+ *  @param[out]  constrained - If given, receives the constraint flag of each edge
+ *  @return 0, or -1 after reporting to cerr, the mesh is left empty then
+ */
+template<typename MeshType>
+int loadMeshSnapshot(const std::string &fileName, MeshType &mesh, std::vector<char> *constrained = nullptr)
+{
+	typedef typename MeshType::Point::value_type	Scalar;
+	typedef typename MeshType::VertexHandle			VH;
+	typedef typename MeshType::HalfedgeHandle		HH;
+	typedef typename MeshType::EdgeHandle			EH;
+	typedef typename MeshType::FaceHandle			FH;
+
+	mesh = MeshType();
+	MappedFile file;
+	if (! file.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	auto error = [&fileName](const char *message) {
+		std::cerr << "Error: " << fileName << ": " << message << std::endl;
+		return -1;
+	};
+	if (file.size() < sizeof(MeshSnapshotHeader))
+		return error("not a mesh snapshot");
+	MeshSnapshotHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, meshSnapshotMagic(), sizeof(header.magic)) != 0)
+		return error("not a mesh snapshot");
+	if (header.version != 1)
+		return error("unsupported version");
+	if (header.scalarSize != sizeof(Scalar))
+		return error("the points are of another type than the ones of the mesh");
+	// 2 * nEdges halfedge indices have to fit into int32.
+	if (header.nVertices > INT32_MAX || header.nEdges > INT32_MAX / 2 || header.nFaces > INT32_MAX)
+		return error("too many items");
+	const uint64_t nV = header.nVertices, nE = header.nEdges, nF = header.nFaces;
+	const uint64_t size = sizeof(header) + meshSnapshotPadded(nV * 2 * sizeof(Scalar)) + meshSnapshotPadded(nV * sizeof(int32_t)) +
+		3 * 2 * nE * sizeof(int32_t) + meshSnapshotPadded(nF * sizeof(int32_t)) + meshSnapshotPadded(nE);
+	if (file.size() != size)
+		return error("size does not match the number of items");
+
+	const char *p = file.data() + sizeof(header);
+	const Scalar  *points			= reinterpret_cast<const Scalar*>(p);	p += meshSnapshotPadded(nV * 2 * sizeof(Scalar));
+	const int32_t *vertexHalfedge	= reinterpret_cast<const int32_t*>(p);	p += meshSnapshotPadded(nV * sizeof(int32_t));
+	const int32_t *halfedgeVertex	= reinterpret_cast<const int32_t*>(p);	p += 2 * nE * sizeof(int32_t);
+	const int32_t *halfedgeNext		= reinterpret_cast<const int32_t*>(p);	p += 2 * nE * sizeof(int32_t);
+	const int32_t *halfedgeFace		= reinterpret_cast<const int32_t*>(p);	p += 2 * nE * sizeof(int32_t);
+	const int32_t *faceHalfedge		= reinterpret_cast<const int32_t*>(p);	p += meshSnapshotPadded(nF * sizeof(int32_t));
+	const char    *edgeConstraint	= p;
+
+	// A damaged file must not make the mesh point outside its arrays.
+	auto inRange = [](const int32_t *first, const uint64_t n, const int64_t lo, const int64_t hi) {
+		for (uint64_t i = 0; i < n; ++ i)
+			if (first[i] < lo || first[i] >= hi)
+				return false;
+		return true;
+	};
+	if (! inRange(vertexHalfedge, nV, -1, int64_t(2 * nE)) || ! inRange(halfedgeVertex, 2 * nE, 0, int64_t(nV)) ||
+		! inRange(halfedgeNext, 2 * nE, 0, int64_t(2 * nE)) || ! inRange(halfedgeFace, 2 * nE, -1, int64_t(nF)) ||
+		! inRange(faceHalfedge, nF, 0, int64_t(2 * nE)))
+		return error("handle out of range");
+
+	mesh.reserve(nV, nE, nF);
+	for (uint64_t i = 0; i < nV; ++ i)
+		mesh.add_vertex(typename MeshType::Point(points[2 * i], points[2 * i + 1]));
+	for (uint64_t i = 0; i < nE; ++ i)
+		mesh.new_edge(VH(halfedgeVertex[2 * i + 1]), VH(halfedgeVertex[2 * i]));
+	for (uint64_t i = 0; i < nF; ++ i)
+		mesh.new_face();
+	for (uint64_t i = 0; i < 2 * nE; ++ i) {
+		const HH hh = mesh.halfedge_handle(EH(int(i / 2)), (unsigned int)(i % 2));
+		mesh.set_next_halfedge_handle(hh, mesh.halfedge_handle(EH(halfedgeNext[i] / 2), (unsigned int)(halfedgeNext[i] % 2)));
+		mesh.set_face_handle(hh, FH(halfedgeFace[i]));
+	}
+	for (uint64_t i = 0; i < nV; ++ i)
+		if (vertexHalfedge[i] >= 0)
+			mesh.set_halfedge_handle(VH(int(i)), mesh.halfedge_handle(EH(vertexHalfedge[i] / 2), (unsigned int)(vertexHalfedge[i] % 2)));
+	for (uint64_t i = 0; i < nF; ++ i)
+		mesh.set_halfedge_handle(FH(int(i)), mesh.halfedge_handle(EH(faceHalfedge[i] / 2), (unsigned int)(faceHalfedge[i] % 2)));
+
+	if (constrained)
+		constrained->assign(edgeConstraint, edgeConstraint + nE);
+	return 0;
+}
@@ -1,12 +1,14 @@
 #pragma once
 
 #include <OpenMesh/Core/Mesh/PolyMesh_ArrayKernelT.hh>
+#include <cstddef>
 
 // Traits for a 2D planar structure.
 // OpenMesh requires all the below listed types to be defined, but the actual memory
 // will be allocated on request. Only the points are allocated by default.
+// The profiles below differ in the attributes only.
 template<typename T>
-struct PolyMeshTraits
+struct PolyMeshTraitsBase
 {
 	/// The default coordinate type is OpenMesh::Vec3f.
 	typedef OpenMesh::VectorT<T,2>  Point;
@@ -32,8 +34,54 @@ struct PolyMeshTraits
 	EdgeTraits      {};
 	FaceTraits      {};
 
+protected:
+	// Bytes per vertex of a triangulated polygon, which has about one face, two edges and four halfedges per vertex.
+	// The ArrayKernel keeps a halfedge handle per vertex and face, and the vertex, face and next handles per halfedge.
+	static size_t bytesPerVertex(const bool prevHalfedge, const bool status)
+	{
+		const size_t handle = sizeof(int);
+		const size_t statusInfo = status ? sizeof(unsigned int) : 0;
+		const size_t vertex   = sizeof(Point) + handle + statusInfo;
+		const size_t halfedge = (prevHalfedge ? 4 : 3) * handle + statusInfo;
+		const size_t edge     = statusInfo;
+		const size_t face     = handle + statusInfo;
+		return vertex + 4 * halfedge + 2 * edge + face;
+	}
+};
+
+// Triangulation only. Without previous halfedges OpenMesh walks the face loop to find them,
+// so insert_edge() on a large polygonal face gets linear, this suits small polygons or meshes which are just stored.
+template<typename T>
+struct PolyMeshTraitsMinimal : public PolyMeshTraitsBase<T>
+{
+	VertexAttributes(0);
+	HalfedgeAttributes(0);
+	EdgeAttributes(0);
+	FaceAttributes(0);
+
+	static size_t bytesPerVertex() { return PolyMeshTraitsBase<T>::bytesPerVertex(false, false); }
+};
+
+// Ear cutting and diagonal flipping, both look up previous halfedges all the time.
+template<typename T>
+struct PolyMeshTraitsFlip : public PolyMeshTraitsBase<T>
+{
+	VertexAttributes(0);
+	HalfedgeAttributes(OpenMesh::Attributes::PrevHalfedge);
+	EdgeAttributes(0);
+	FaceAttributes(0);
+
+	static size_t bytesPerVertex() { return PolyMeshTraitsBase<T>::bytesPerVertex(true, false); }
+};
+
+// Editing, the status flags are needed to delete items and to collect the garbage.
+template<typename T>
+struct PolyMeshTraits : public PolyMeshTraitsBase<T>
+{
 	VertexAttributes(OpenMesh::Attributes::Status);
 	HalfedgeAttributes(OpenMesh::Attributes::PrevHalfedge | OpenMesh::Attributes::Status);
 	EdgeAttributes(OpenMesh::Attributes::Status);
 	FaceAttributes(OpenMesh::Attributes::Status);
+
+	static size_t bytesPerVertex() { return PolyMeshTraitsBase<T>::bytesPerVertex(true, true); }
 };
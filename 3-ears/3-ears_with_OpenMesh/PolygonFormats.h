@@ -0,0 +1,642 @@
+#pragma once
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "BufferedWriter.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Binary polygon file (.bpoly): a 64 byte header followed by count packed VectorT<T, 2> points,
+// all in the byte order of the machine which wrote it (little endian on everything we run on).
+// The points start at a 64 byte boundary of the mapping, so they can be used in place.
+enum BinaryPointType
+{
+	BINARY_POINT_FLOAT	= 1,
+	BINARY_POINT_DOUBLE	= 2,
+	BINARY_POINT_INT32	= 3
+};
+
+struct BinaryPolygonHeader
+{
+	char		magic[8];		// "BPOLY" padded by zeros
+	uint32_t	version;		// 1
+	uint32_t	pointType;		// BinaryPointType
+	uint64_t	count;			// number of points
+	double		bbox[4];		// xMin, yMin, xMax, yMax
+	uint64_t	reserved;
+};
+static_assert(sizeof(BinaryPolygonHeader) == 64, "The points are expected to start at byte 64");
+
+template<typename T> struct BinaryPointTypeOf;
+template<> struct BinaryPointTypeOf<float>   { static const uint32_t value = BINARY_POINT_FLOAT; };
+template<> struct BinaryPointTypeOf<double>  { static const uint32_t value = BINARY_POINT_DOUBLE; };
+template<> struct BinaryPointTypeOf<int32_t> { static const uint32_t value = BINARY_POINT_INT32; };
+
+inline size_t binaryPointSize(const uint32_t pointType)
+{
+	switch (pointType) {
+	case BINARY_POINT_FLOAT:  return 2 * sizeof(float);
+	case BINARY_POINT_DOUBLE: return 2 * sizeof(double);
+	case BINARY_POINT_INT32:  return 2 * sizeof(int32_t);
+	default:                  return 0;
+	}
+}
+
+inline bool hasExtension(const std::string &fileName, const std::string &extension)
+{
+	return fileName.size() >= extension.size() && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Memory mapped .bpoly file. Opening it only checks the header, the points are read by the OS when they are touched.
+class BinaryPolygonFile
+{
+public:
+	// Returns false and reports to cerr if the file cannot be mapped or is no valid .bpoly file.
+	bool open(const std::string &fileName)
+	{
+		if (! file.open(fileName)) {
+			std::cerr << "Cannot open " << fileName << std::endl;
+			return false;
+		}
+		const char *error = nullptr;
+		if (file.size() < sizeof(BinaryPolygonHeader) || memcmp(header().magic, magic(), sizeof(header().magic)) != 0)
+			error = "not a .bpoly file";
+		else if (header().version != 1)
+			error = "unsupported version";
+		else if (binaryPointSize(header().pointType) == 0)
+			error = "unknown point type";
+		else if (header().count > (file.size() - sizeof(BinaryPolygonHeader)) / binaryPointSize(header().pointType) ||
+			file.size() != sizeof(BinaryPolygonHeader) + header().count * binaryPointSize(header().pointType))
+			error = "size does not match the number of points";
+		if (error) {
+			std::cerr << "Error: " << fileName << ": " << error << std::endl;
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() { file.close(); }
+
+	const BinaryPolygonHeader& header() const { return *reinterpret_cast<const BinaryPolygonHeader*>(file.data()); }
+	size_t size() const { return size_t(header().count); }
+
+	// The points in place if they are stored as T, otherwise null.
+	template<typename T>
+	const OpenMesh::VectorT<T, 2>* points() const
+	{
+		return (header().pointType == BinaryPointTypeOf<T>::value) ?
+			reinterpret_cast<const OpenMesh::VectorT<T, 2>*>(file.data() + sizeof(BinaryPolygonHeader)) : nullptr;
+	}
+
+	// Point i converted to T.
+	template<typename T>
+	OpenMesh::VectorT<T, 2> point(const size_t i) const
+	{
+		switch (header().pointType) {
+		case BINARY_POINT_FLOAT:  return converted<float, T>(i);
+		case BINARY_POINT_DOUBLE: return converted<double, T>(i);
+		default:                  return converted<int32_t, T>(i);
+		}
+	}
+
+	// Appends the points converted to T to out.
+	template<typename T, typename OutputIterator>
+	void copyPoints(OutputIterator out) const
+	{
+		switch (header().pointType) {
+		case BINARY_POINT_FLOAT:  copyConverted<float, T>(out); break;
+		case BINARY_POINT_DOUBLE: copyConverted<double, T>(out); break;
+		case BINARY_POINT_INT32:  copyConverted<int32_t, T>(out); break;
+		}
+	}
+
+	static const char* magic() { return "BPOLY\0\0"; }
+
+private:
+	template<typename S, typename T>
+	OpenMesh::VectorT<T, 2> converted(const size_t i) const
+	{
+		const OpenMesh::VectorT<S, 2> &p = points<S>()[i];
+		return OpenMesh::VectorT<T, 2>(T(p[0]), T(p[1]));
+	}
+
+	template<typename S, typename T, typename OutputIterator>
+	void copyConverted(OutputIterator out) const
+	{
+		for (size_t i = 0; i < size(); ++ i)
+			*out++ = converted<S, T>(i);
+	}
+
+	MappedFile file;
+};
+
+/** Writes the points [first, last) of type VectorT<T, 2> with T float, double or int32_t to a .bpoly file.
+ *  @return 0, or -1 if the file cannot be written
+ */
+template<typename ForwardIterator>
+int writeBinaryPolygon(const std::string &fileName, const ForwardIterator first, const ForwardIterator last)
+{
+	typedef typename std::iterator_traits<ForwardIterator>::value_type VecType;
+	typedef typename VecType::value_type T;
+
+	BinaryPolygonHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BinaryPolygonFile::magic(), sizeof(header.magic));
+	header.version   = 1;
+	header.pointType = BinaryPointTypeOf<T>::value;
+	header.bbox[0] = header.bbox[1] =   std::numeric_limits<double>::max();
+	header.bbox[2] = header.bbox[3] = - std::numeric_limits<double>::max();
+	for (ForwardIterator it = first; it != last; ++ it, ++ header.count)
+		for (int i = 0; i < 2; ++ i) {
+			header.bbox[i]     = std::min(header.bbox[i],     double((*it)[i]));
+			header.bbox[i + 2] = std::max(header.bbox[i + 2], double((*it)[i]));
+		}
+
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	out.write(&header, sizeof(header));
+	for (ForwardIterator it = first; it != last; ++ it) {
+		const T xy[2] = { (*it)[0], (*it)[1] };
+		out.write(xy, sizeof(xy));
+	}
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Quantized polygon file (.qpoly): a 64 byte header followed by the points snapped to the grid
+// origin + (i, j) * step. Each point is stored as the difference of its grid indices to the previous point
+// (to 0 for the first one), both zigzag encoded and packed as varints of 7 bits per byte, the lowest first.
+// Consecutive vertices of a ring are close, so a point mostly takes 4 to 6 bytes instead of about 40 of text.
+struct QuantizedPolygonHeader
+{
+	char		magic[8];		// "QPOLY" padded by zeros
+	uint32_t	version;		// 1
+	uint32_t	reserved0;
+	uint64_t	count;			// number of points
+	double		origin[2];
+	double		step;			// grid spacing, the same in x and y
+	double		reserved1[2];
+};
+static_assert(sizeof(QuantizedPolygonHeader) == 64, "The points are expected to start at byte 64");
+
+inline uint64_t zigzagEncode(const int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t  zigzagDecode(const uint64_t v) { return int64_t(v >> 1) ^ - int64_t(v & 1); }
+
+// Memory mapped .qpoly file, decoded on the fly without a buffer of the points.
+class QuantizedPolygonFile
+{
+public:
+	// Returns false and reports to cerr if the file cannot be mapped or its header is not valid.
+	bool open(const std::string &fileName)
+	{
+		name = fileName;
+		if (! file.open(fileName)) {
+			std::cerr << "Cannot open " << fileName << std::endl;
+			return false;
+		}
+		const char *error = nullptr;
+		if (file.size() < sizeof(QuantizedPolygonHeader) || memcmp(header().magic, magic(), sizeof(header().magic)) != 0)
+			error = "not a .qpoly file";
+		else if (header().version != 1)
+			error = "unsupported version";
+		else if (! (header().step > 0.))
+			error = "invalid grid step";
+		// A point takes at least two bytes, one per varint: this bounds what size() may report to the callers
+		// reserving for it, before decode() finds the data truncated.
+		else if (header().count > (file.size() - sizeof(QuantizedPolygonHeader)) / 2)
+			error = "invalid point count";
+		if (error) {
+			std::cerr << "Error: " << fileName << ": " << error << std::endl;
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	const QuantizedPolygonHeader& header() const { return *reinterpret_cast<const QuantizedPolygonHeader*>(file.data()); }
+	size_t size() const { return size_t(header().count); }
+
+	/** Decodes the points one by one into out as VectorT<T, 2>.
+	 *  @return false if the data end before all the points are decoded, the points decoded so far are written then
+	 */
+	template<typename T, typename OutputIterator>
+	bool decode(OutputIterator out) const
+	{
+		const unsigned char *p   = reinterpret_cast<const unsigned char*>(file.data()) + sizeof(QuantizedPolygonHeader);
+		const unsigned char *end = reinterpret_cast<const unsigned char*>(file.data()) + file.size();
+		const double x0 = header().origin[0], y0 = header().origin[1], step = header().step;
+		int64_t i = 0, j = 0;
+		for (uint64_t k = 0; k < header().count; ++ k) {
+			uint64_t di, dj;
+			if (! readVarint(p, end, di) || ! readVarint(p, end, dj)) {
+				std::cerr << "Error: " << name << ": truncated after " << k << " of " << header().count << " points" << std::endl;
+				return false;
+			}
+			i += zigzagDecode(di);
+			j += zigzagDecode(dj);
+			*out++ = OpenMesh::VectorT<T, 2>(T(x0 + double(i) * step), T(y0 + double(j) * step));
+		}
+		return true;
+	}
+
+	static const char* magic() { return "QPOLY\0\0"; }
+
+private:
+	static bool readVarint(const unsigned char *&p, const unsigned char *end, uint64_t &v)
+	{
+		v = 0;
+		for (int shift = 0; p != end && shift < 64; shift += 7) {
+			const unsigned char byte = *p++;
+			v |= uint64_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	MappedFile	file;
+	std::string	name;
+};
+
+/** Writes the points [first, last) snapped to a grid of the given step to a .qpoly file.
+ *  The grid starts in the lower left corner of the bounding box, so a decoded point is at most step / 2 off in x and y.
+ *  @return 0, or -1 if the step is too small for the extent of the points or the file cannot be written
+ */
+template<typename ForwardIterator>
+int writeQuantizedPolygon(const std::string &fileName, const ForwardIterator first, const ForwardIterator last, const double step)
+{
+	QuantizedPolygonHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, QuantizedPolygonFile::magic(), sizeof(header.magic));
+	header.version = 1;
+	header.step    = step;
+	double bbox[4] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), - std::numeric_limits<double>::max(), - std::numeric_limits<double>::max() };
+	for (ForwardIterator it = first; it != last; ++ it, ++ header.count)
+		for (int i = 0; i < 2; ++ i) {
+			bbox[i]     = std::min(bbox[i],     double((*it)[i]));
+			bbox[i + 2] = std::max(bbox[i + 2], double((*it)[i]));
+		}
+	if (header.count > 0) {
+		header.origin[0] = bbox[0];
+		header.origin[1] = bbox[1];
+	}
+	// The grid indices have to fit into int64_t with room for the differences.
+	if (! (step > 0.) || (header.count > 0 && std::max(bbox[2] - bbox[0], bbox[3] - bbox[1]) / step > 1e18)) {
+		std::cerr << "Invalid grid step " << step << " for " << fileName << std::endl;
+		return -1;
+	}
+
+	BufferedWriter out;
+	if (! out.open(fileName)) {
+		std::cerr << "Cannot open " << fileName << std::endl;
+		return -1;
+	}
+	out.write(&header, sizeof(header));
+	auto writeVarint = [&out](uint64_t v) {
+		for (; v >= 0x80; v >>= 7)
+			out.put(char(v | 0x80));
+		out.put(char(v));
+	};
+	int64_t iPrev = 0, jPrev = 0;
+	for (ForwardIterator it = first; it != last; ++ it) {
+		const int64_t i = llround((double((*it)[0]) - header.origin[0]) / step);
+		const int64_t j = llround((double((*it)[1]) - header.origin[1]) / step);
+		writeVarint(zigzagEncode(i - iPrev));
+		writeVarint(zigzagEncode(j - jPrev));
+		iPrev = i;
+		jPrev = j;
+	}
+	if (! out.close()) {
+		std::cerr << "Cannot write " << fileName << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+// Multi-polygon file (.mpoly) holding many rings: a 64 byte header, the packed VectorT<T, 2> points of all the rings
+// one after another, the index of nPolygons + 1 uint64 point offsets of the rings, the last one being the total,
+// and a trailer giving the number of rings and the byte offset of the index. The index comes last,
+// so the rings can be written one by one without knowing their number in advance.
+struct MultiPolygonHeader
+{
+	char		magic[8];		// "MPOLY" padded by zeros
+	uint32_t	version;		// 1
+	uint32_t	pointType;		// BINARY_POINT_FLOAT or BINARY_POINT_DOUBLE
+	uint64_t	reserved[6];
+};
+static_assert(sizeof(MultiPolygonHeader) == 64, "The points are expected to start at byte 64");
+
+struct MultiPolygonTrailer
+{
+	uint64_t	nPolygons;
+	uint64_t	indexOffset;
+	char		magic[8];		// "MPOLY" padded by zeros, as in the header
+};
+
+inline const char* multiPolygonMagic() { return "MPOLY\0\0"; }
+
+// Writes the rings added one by one to a .mpoly file of points of type T.
+template<typename T>
+class MultiPolygonWriter
+{
+public:
+	typedef OpenMesh::VectorT<T, 2> VecType;
+
+	bool open(const std::string &fileName)
+	{
+		name = fileName;
+		offsets.assign(1, 0);
+		if (! out.open(fileName)) {
+			std::cerr << "Cannot open " << fileName << std::endl;
+			return false;
+		}
+		MultiPolygonHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, multiPolygonMagic(), sizeof(header.magic));
+		header.version   = 1;
+		header.pointType = BinaryPointTypeOf<T>::value;
+		out.write(&header, sizeof(header));
+		return true;
+	}
+
+	template<typename ForwardIterator>
+	void add(const ForwardIterator first, const ForwardIterator last)
+	{
+		uint64_t n = 0;
+		for (ForwardIterator it = first; it != last; ++ it, ++ n) {
+			const T xy[2] = { T((*it)[0]), T((*it)[1]) };
+			out.write(xy, sizeof(xy));
+		}
+		offsets.push_back(offsets.back() + n);
+	}
+
+	// Writes the index. Returns 0, or -1 after reporting to cerr.
+	int close()
+	{
+		MultiPolygonTrailer trailer;
+		memset(&trailer, 0, sizeof(trailer));
+		trailer.nPolygons	= offsets.size() - 1;
+		trailer.indexOffset	= sizeof(MultiPolygonHeader) + offsets.back() * sizeof(VecType);
+		memcpy(trailer.magic, multiPolygonMagic(), sizeof(trailer.magic));
+		out.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+		out.write(&trailer, sizeof(trailer));
+		if (! out.close()) {
+			std::cerr << "Cannot write " << name << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+private:
+	BufferedWriter			out;
+	std::string				name;
+	std::vector<uint64_t>	offsets;
+};
+
+// Memory mapped .mpoly file with random access to its rings, which may be used in place.
+class MultiPolygonFile
+{
+public:
+	// Returns false and reports to cerr if the file cannot be mapped or is no valid .mpoly file.
+	bool open(const std::string &fileName)
+	{
+		if (! file.open(fileName)) {
+			std::cerr << "Cannot open " << fileName << std::endl;
+			return false;
+		}
+		const char *error = nullptr;
+		MultiPolygonTrailer trailer;
+		if (file.size() < sizeof(MultiPolygonHeader) + sizeof(uint64_t) + sizeof(MultiPolygonTrailer) ||
+			memcmp(header().magic, multiPolygonMagic(), sizeof(header().magic)) != 0)
+			error = "not a .mpoly file";
+		else if (header().version != 1)
+			error = "unsupported version";
+		else if (header().pointType != BINARY_POINT_FLOAT && header().pointType != BINARY_POINT_DOUBLE)
+			error = "unknown point type";
+		else {
+			memcpy(&trailer, file.end() - sizeof(trailer), sizeof(trailer));
+			// Only valid once indexOffset is checked to be in the file. The number of rings is compared
+			// by division, since (nPolygons + 1) * 8 may overflow for a damaged trailer.
+			const uint64_t indexSize = file.size() - sizeof(trailer) - trailer.indexOffset;
+			if (memcmp(trailer.magic, multiPolygonMagic(), sizeof(trailer.magic)) != 0 ||
+				trailer.indexOffset < sizeof(MultiPolygonHeader) || trailer.indexOffset > file.size() - sizeof(trailer) ||
+				trailer.indexOffset % sizeof(uint64_t) != 0 ||
+				indexSize < sizeof(uint64_t) || indexSize % sizeof(uint64_t) != 0 ||
+				trailer.nPolygons != indexSize / sizeof(uint64_t) - 1)
+				error = "damaged index";
+			else {
+				nPolygons = size_t(trailer.nPolygons);
+				offsets   = reinterpret_cast<const uint64_t*>(file.data() + trailer.indexOffset);
+				const uint64_t nPoints = (trailer.indexOffset - sizeof(MultiPolygonHeader)) / binaryPointSize(header().pointType);
+				for (size_t i = 0; i < nPolygons && ! error; ++ i)
+					if (offsets[i] > offsets[i + 1])
+						error = "damaged index";
+				if (offsets[0] != 0 || offsets[nPolygons] != nPoints ||
+					(trailer.indexOffset - sizeof(MultiPolygonHeader)) % binaryPointSize(header().pointType) != 0)
+					error = "damaged index";
+			}
+		}
+		if (error) {
+			std::cerr << "Error: " << fileName << ": " << error << std::endl;
+			file.close();
+			nPolygons = 0;
+			offsets   = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	const MultiPolygonHeader& header() const { return *reinterpret_cast<const MultiPolygonHeader*>(file.data()); }
+
+	// Number of rings.
+	size_t size() const { return nPolygons; }
+	// Number of points of ring i.
+	size_t polygonSize(const size_t i) const { return size_t(offsets[i + 1] - offsets[i]); }
+	// Index of the first point of ring i among the points of all the rings.
+	size_t firstPoint(const size_t i) const { return size_t(offsets[i]); }
+
+	// The points of ring i in place if they are stored as T, otherwise null.
+	template<typename T>
+	const OpenMesh::VectorT<T, 2>* points(const size_t i) const
+	{
+		return (header().pointType == BinaryPointTypeOf<T>::value) ?
+			reinterpret_cast<const OpenMesh::VectorT<T, 2>*>(file.data() + sizeof(MultiPolygonHeader)) + offsets[i] : nullptr;
+	}
+
+	// Writes the points of ring i converted to T to out.
+	template<typename T, typename OutputIterator>
+	void copyPolygon(const size_t i, OutputIterator out) const
+	{
+		if (header().pointType == BINARY_POINT_FLOAT)
+			copyConverted<float, T>(i, out);
+		else
+			copyConverted<double, T>(i, out);
+	}
+
+private:
+	template<typename S, typename T, typename OutputIterator>
+	void copyConverted(const size_t i, OutputIterator out) const
+	{
+		const OpenMesh::VectorT<S, 2> *p = points<S>(i);
+		for (size_t j = 0; j < polygonSize(i); ++ j)
+			*out++ = OpenMesh::VectorT<T, 2>(T(p[j][0]), T(p[j][1]));
+	}
+
+	MappedFile		 file;
+	size_t			 nPolygons = 0;
+	const uint64_t	*offsets   = nullptr;
+};
+
+// Whitespace between the coordinates, including the line ends.
+inline bool isPointSeparator(const char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/** Parses whitespace separated coordinate pairs by std::from_chars, which is neither locale aware nor reads through a stream.
+ *  @param[in]      first, last - Text to parse
+ *  @param[out]     points      - The points are appended
+ *  @param[in,out]  line        - Line number of first, advanced to the line of the error or to the end
+ *  @return null, or the message of a syntax error, the points parsed so far are kept then
+ */
+template<typename T>
+const char* parsePoints(const char *first, const char *last, std::vector<OpenMesh::VectorT<T, 2>> &points, size_t &line)
+{
+	const char *p = first;
+	auto skipSeparators = [&p, last, &line]() {
+		for (; p != last && isPointSeparator(*p); ++ p)
+			if (*p == '\n')
+				++ line;
+	};
+
+	for (;;) {
+		skipSeparators();
+		if (p == last)
+			return nullptr;
+		OpenMesh::VectorT<T, 2> v;
+		const size_t lineX = line;
+		for (int i = 0; i < 2; ++ i) {
+			if (i == 1) {
+				skipSeparators();
+				if (p == last) {
+					line = lineX;
+					return "missing y coordinate";
+				}
+			}
+			if (*p == '+')
+				++ p;
+			const std::from_chars_result result = std::from_chars(p, last, v[i]);
+			if (result.ec == std::errc::result_out_of_range)
+				return "number out of range";
+			if (result.ec != std::errc())
+				return "expected a number";
+			p = result.ptr;
+			if (p != last && ! isPointSeparator(*p))
+				return "unexpected character after a number";
+		}
+		points.push_back(v);
+	}
+}
+
+/** Reads inputFileName + ".txt" into points of the float type of the kernel, which are cleared first.
+ *  A file name ending by .bpoly is read as a binary polygon, see BinaryPolygonFile, which PolygonPoints uses in place instead,
+ *  one ending by .qpoly as a quantized polygon, see QuantizedPolygonFile.
+ *  With a pool, large files are cut into chunks at line ends, which are parsed in parallel and concatenated in order.
+ *  A point must not span two lines then, which writePoints() never does.
+ *  @return number of points read or -1, syntax errors are reported with their line numbers;
+ *          64 bits wide, a file may hold more points than an int counts
+ */
+template<class KERNEL>
+int64_t loadPoints(const std::string &inputFileName, std::vector<OpenMesh::VectorT<typename KERNEL::FloatType, 2>> &points, ThreadPool *pool = nullptr)
+{
+	typedef OpenMesh::VectorT<typename KERNEL::FloatType, 2> VecType;
+
+	points.clear();
+	if (hasExtension(inputFileName, ".bpoly")) {
+		BinaryPolygonFile binary;
+		if (! binary.open(inputFileName))
+			return -1;
+		points.reserve(binary.size());
+		binary.copyPoints<typename KERNEL::FloatType>(std::back_inserter(points));
+		return int64_t(points.size());
+	}
+	if (hasExtension(inputFileName, ".qpoly")) {
+		QuantizedPolygonFile quantized;
+		if (! quantized.open(inputFileName))
+			return -1;
+		points.reserve(quantized.size());
+		if (! quantized.decode<typename KERNEL::FloatType>(std::back_inserter(points)))
+			return -1;
+		return int64_t(points.size());
+	}
+
+	const std::string path = inputFileName + ".txt";
+	MappedFile file;
+	if (! file.open(path)) {
+		std::cerr << "Cannot open " << inputFileName << std::endl;
+		return -1;
+	}
+
+	// Below 1MB per thread, starting the chunks costs more than they save.
+	const size_t minChunkBytes = 1 << 20;
+	const size_t nChunks = pool ? std::max<size_t>(1, std::min<size_t>(pool->size(), file.size() / minChunkBytes)) : 1;
+	std::vector<const char*> bounds(nChunks + 1, file.end());
+	bounds[0] = file.begin();
+	for (size_t i = 1; i < nChunks; ++ i) {
+		const char *end = std::find(std::max(bounds[i - 1], file.begin() + file.size() * i / nChunks), file.end(), '\n');
+		bounds[i] = (end == file.end()) ? end : end + 1;
+	}
+
+	// Each chunk counts its lines from 0, the global line numbers are known after all the chunks before are done.
+	std::vector<std::vector<VecType>>	chunkPoints(nChunks);
+	std::vector<size_t>					chunkLines(nChunks, 0);
+	std::vector<const char*>			chunkErrors(nChunks, nullptr);
+	auto parseChunk = [&](size_t i) {
+		std::vector<VecType> &out = (nChunks == 1) ? points : chunkPoints[i];
+		// One point per line, the last one possibly without a line end.
+		out.reserve(std::count(bounds[i], bounds[i + 1], '\n') + 1);
+		chunkErrors[i] = parsePoints(bounds[i], bounds[i + 1], out, chunkLines[i]);
+	};
+	if (pool)
+		pool->parallelFor(0, nChunks, parseChunk);
+	else
+		parseChunk(0);
+
+	size_t line = 1;
+	for (size_t i = 0; i < nChunks; ++ i) {
+		if (chunkErrors[i]) {
+			std::cerr << "Error: " << path << ", line " << line + chunkLines[i] << ": " << chunkErrors[i] << std::endl;
+			return -1;
+		}
+		line += chunkLines[i];
+	}
+
+	if (pool && nChunks > 1) {
+		std::vector<size_t> offsets(nChunks + 1, 0);
+		for (size_t i = 0; i < nChunks; ++ i)
+			offsets[i + 1] = offsets[i] + chunkPoints[i].size();
+		points.resize(offsets[nChunks]);
+		pool->parallelFor(0, nChunks, [&](size_t i) {
+			std::copy(chunkPoints[i].begin(), chunkPoints[i].end(), points.begin() + offsets[i]);
+			std::vector<VecType>().swap(chunkPoints[i]);
+		});
+	}
+	return int64_t(points.size());
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <limits.h>
+#include <assert.h>
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include "ExactPredicates.h"
+
+// The geometric predicates the kernels are made of, see Kernel in main.cpp.
+// Exact and adaptive ones call Shewchuk's predicates, which need ExactPredicates::exactinit() first:
+// the exact ones orient2dexact and incircleexact, which always expand the determinant, the adaptive ones
+// orient2d and incircle, which only do when its floating point value is too close to zero.
+
+using OpenMesh::VectorT;
+
+enum OrientationType
+{
+  ORIENTATION_UNDEF  = INT_MAX,
+  RIGHT_TURN	= -1,
+  STRAIGHT	= 0,
+  LEFT_TURN	= 1
+};
+
+// The naive version of the operator as 2x2 determinant ()()-()()
+template <typename T>
+struct Orient2dNaive
+{
+  OrientationType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c)
+  {   
+    T result =  (a[0] - c[0])*(b[1]-c[1]) - (a[1] - c[1])*(b[0]-c[0]);  //PIVOT c
+    
+    if(result > (T)0)
+      return LEFT_TURN;
+    else if (result < (T)0)
+      return RIGHT_TURN;
+    else 
+      return STRAIGHT;
+  }
+};
+
+
+template <typename T>
+struct Orient2dExact
+{
+  OrientationType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c)
+  {    
+
+	T result = ExactPredicates::orient2dexact( &a[0], &b[0], &c[0] );  //PIVOT a
+
+    if(result > 0.0)
+      return LEFT_TURN;
+    else if (result < 0.0)
+      return RIGHT_TURN;
+    else 
+      return STRAIGHT;
+  }
+};
+
+
+// Shewchuk's adaptive test: the floating point determinant, refined in exact arithmetic
+// only if it is too close to zero to trust its sign. Exact, and about as fast as Orient2dNaive on most input.
+template <typename T>
+struct Orient2dAdaptive
+{
+  OrientationType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c)
+  {
+    double pa[2] = { double(a[0]), double(a[1]) };
+    double pb[2] = { double(b[0]), double(b[1]) };
+    double pc[2] = { double(c[0]), double(c[1]) };
+    double result = ExactPredicates::orient2d( pa, pb, pc );
+
+    if(result > 0.0)
+      return LEFT_TURN;
+    else if (result < 0.0)
+      return RIGHT_TURN;
+    else 
+      return STRAIGHT;
+  }
+};
+
+
+// Returns true if r is on the extension of the ray starting in q in
+// the direction q-p, i.e., if (q-p)*(r-q) >= 0, and false otherwise.
+// Naive implementation, which is not precise with float / double types,
+// but may deliver more precise results than Extended2dExact if the points are not exactly collinear.
+template< class T>
+struct Extended2dNaive
+{
+  bool operator()(VectorT<T, 2> p, VectorT<T, 2> q, VectorT<T, 2> r)
+  {   
+    return ((q.x-p.x) * (r.x-q.x) >= (p.y-q.y) * (r.y-q.y));
+  }
+};
+
+// Returns true if r is on the extension of the ray starting in q in
+// the direction q-p, i.e., if (q-p)*(r-q) >= 0, and false otherwise.
+// Exact implementation, works only if p, q, r are collinear.
+template< class T>
+struct Extended2dExact
+{
+  bool operator()(VectorT<T, 2> p, VectorT<T, 2> q, VectorT<T, 2> r)
+  {   
+     assert(Orient2dAdaptive<T>()(p, q, r) == STRAIGHT);
+     return ( p.x == q.x ) ?
+       ( (p.y <= q.y) ? (q.y <= r.y) : (q.y >= r.y) ) :
+       ( (p.x <= q.x) ? (q.x <= r.x) : (q.x >= r.x) );
+  }
+};
+
+enum InsideOutsideType
+{
+  INOUT_UNDEF		= INT_MAX,
+  INOUT_INSIDE		= -1,
+  INOUT_BOUNDARY	= 0,
+  INOUT_OUTSIDE		= 1
+};
+
+/// test, if point d is in the circumcircle to points a,b,c
+template< class T>
+struct InCircleNaive
+{
+  InsideOutsideType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c, VectorT<T, 2> d)
+  {   
+	  VectorT<T, 2> ad = a - d;
+	  VectorT<T, 2> bd = b - d;
+	  VectorT<T, 2> cd = c - d;
+    T abdet = ad[0] * bd[1] - bd[0] * ad[1];
+	  T bcdet = bd[0] * cd[1] - cd[0] * bd[1];
+	  T cadet = cd[0] * ad[1] - ad[0] * cd[1];
+	  T alift = ad[0] * ad[0] + ad[1] * ad[1];
+	  T blift = bd[0] * bd[0] + bd[1] * bd[1];
+	  T clift = cd[0] * cd[0] + cd[1] * cd[1];
+	  T det = alift * bcdet + blift * cadet + clift * abdet;
+	  return (det > 0) ? INOUT_INSIDE : ((det < 0) ? INOUT_OUTSIDE : INOUT_BOUNDARY);
+  }
+};
+
+/// test, if point d is in the circumcircle to points a,b,c
+/// always evaluated in exact arithmetic
+template< class T>
+struct InCircleExact
+{
+  InsideOutsideType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c, VectorT<T, 2> d)
+  {   
+	 T det = ExactPredicates::incircleexact(&a[0], &b[0], &c[0], &d[0]);
+	 return (det > 0) ? INOUT_INSIDE : ((det < 0) ? INOUT_OUTSIDE : INOUT_BOUNDARY);
+  }
+};
+
+/// test, if point d is in the circumcircle to points a,b,c
+/// Shewchuk's adaptive test, exact as InCircleExact, see Orient2dAdaptive
+template< class T>
+struct InCircleAdaptive
+{
+  InsideOutsideType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c, VectorT<T, 2> d)
+  {   
+	 double pa[2] = { double(a[0]), double(a[1]) };
+	 double pb[2] = { double(b[0]), double(b[1]) };
+	 double pc[2] = { double(c[0]), double(c[1]) };
+	 double pd[2] = { double(d[0]), double(d[1]) };
+	 double det = ExactPredicates::incircle(pa, pb, pc, pd);
+	 return (det > 0) ? INOUT_INSIDE : ((det < 0) ? INOUT_OUTSIDE : INOUT_BOUNDARY);
+  }
+};
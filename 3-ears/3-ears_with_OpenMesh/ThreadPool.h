@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads.
+// The thread calling parallelFor() takes part in the work, so a pool of size 1 has no workers
+// and runs everything inline.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned nThreads = std::thread::hardware_concurrency())
+	{
+		if (nThreads == 0)
+			nThreads = 1;
+		for (unsigned i = 1; i < nThreads; ++ i)
+			workers.emplace_back([this]() { this->workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cvTask.notify_all();
+		for (std::thread &t : workers)
+			t.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads taking part in parallelFor(), including the calling one.
+	unsigned size() const { return unsigned(workers.size()) + 1; }
+
+	// Calls fn(i) for all i in [begin, end) and blocks until all calls have finished.
+	// The range is split into at most size() contiguous chunks of at least minChunk items,
+	// so which thread processes an item never influences the result.
+	// Must not be called from inside fn, the nested call could wait for its own chunks forever.
+	template<typename Fn>
+	void parallelFor(size_t begin, size_t end, Fn fn, size_t minChunk = 1)
+	{
+		if (begin >= end)
+			return;
+		const size_t count   = end - begin;
+		const size_t nChunks = std::min<size_t>(size(), std::max<size_t>(1, count / std::max<size_t>(1, minChunk)));
+		runOnThreads(unsigned(nChunks), [&fn, begin, count, nChunks](size_t iChunk) {
+			const size_t first = begin + count * iChunk / nChunks;
+			const size_t last  = begin + count * (iChunk + 1) / nChunks;
+			for (size_t i = first; i < last; ++ i)
+				fn(i);
+		});
+	}
+
+	// Calls fn(i, thread) for all i in [begin, end) and blocks until all calls have finished.
+	// The items are started in increasing order, each thread takes the next one left as soon as it is done,
+	// so items of very different costs are balanced. Which thread gets an item depends on the timing,
+	// thread < size() only tells the threads apart, e.g. to index buffers of their own.
+	// Same restriction on nesting as parallelFor().
+	template<typename Fn>
+	void parallelForDynamic(size_t begin, size_t end, Fn fn)
+	{
+		if (begin >= end)
+			return;
+		std::atomic<size_t> next(begin);
+		runOnThreads(unsigned(std::min<size_t>(size(), end - begin)), [&fn, &next, end](size_t thread) {
+			for (size_t i = next ++; i < end; i = next ++)
+				fn(i, unsigned(thread));
+		});
+	}
+
+private:
+	// Calls fn(i) for i in [0, n), fn(0) on the calling thread, and waits for all of them.
+	template<typename Fn>
+	void runOnThreads(const unsigned n, Fn fn)
+	{
+		if (n <= 1) {
+			fn(0);
+			return;
+		}
+		std::mutex				mutexDone;
+		std::condition_variable	cvDone;
+		size_t					nRunning = n - 1;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 1; i < n; ++ i)
+				tasks.emplace_back([&, i]() {
+					fn(i);
+					std::lock_guard<std::mutex> lockDone(mutexDone);
+					if (-- nRunning == 0)
+						cvDone.notify_one();
+				});
+		}
+		cvTask.notify_all();
+		fn(0);
+		std::unique_lock<std::mutex> lockDone(mutexDone);
+		cvDone.wait(lockDone, [&nRunning]() { return nRunning == 0; });
+	}
+
+	void workerLoop()
+	{
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cvTask.wait(lock, [this]() { return stop || ! tasks.empty(); });
+				if (tasks.empty())
+					return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread>			workers;
+	std::deque<std::function<void()>>	tasks;
+	std::mutex							mutex;
+	std::condition_variable				cvTask;
+	bool								stop = false;
+};
@@ -0,0 +1,222 @@
+/* bench_predicates.cpp
+*
+* Throughput of the predicates of Predicates.h on float and double, to choose the kernel of a run.
+*
+* For random, nearly collinear and nearly cocircular input it prints the time per call, the share of calls
+* which needed exact arithmetic, and the share of signs which differ from the exact ones.
+*
+* Build: make bench_predicates
+* Usage: bench_predicates [number of cases, default 65536]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "Predicates.h"
+
+enum InputKind {
+	INPUT_RANDOM,				// uniform in [-1, 1]^2
+	INPUT_NEARLY_COLLINEAR,		// c on the line ab up to rounding
+	INPUT_NEARLY_COCIRCULAR,	// all four on one circle up to rounding
+};
+
+static const char* inputName(const InputKind kind)
+{
+	switch (kind) {
+	case INPUT_RANDOM:				return "random";
+	case INPUT_NEARLY_COLLINEAR:	return "nearly collinear";
+	default:						return "nearly cocircular";
+	}
+}
+
+// Four points a, b, c, d per case, the orientation tests take the first three.
+// The points are computed in T, so they are as close to degenerate as T can make them.
+template<typename T>
+std::vector<VectorT<T, 2>> makeInput(const InputKind kind, const size_t nCases, std::mt19937_64 &rng)
+{
+	typedef VectorT<T, 2> Vec;
+	std::uniform_real_distribution<T> coord(T(-1), T(1));
+	std::uniform_real_distribution<T> param(T(-1), T(2));
+	std::uniform_real_distribution<double> angle(0., 2. * M_PI);
+	auto random = [&]() { return Vec(coord(rng), coord(rng)); };
+
+	std::vector<Vec> points;
+	points.reserve(4 * nCases);
+	for (size_t i = 0; i < nCases; ++ i) {
+		if (kind == INPUT_RANDOM) {
+			for (int j = 0; j < 4; ++ j)
+				points.push_back(random());
+		} else if (kind == INPUT_NEARLY_COLLINEAR) {
+			const Vec a = random(), b = random();
+			const T t = param(rng);
+			points.push_back(a);
+			points.push_back(b);
+			points.push_back(Vec(a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1])));
+			points.push_back(random());
+		} else {
+			const Vec center = random();
+			const T radius = T(0.5) + T(0.5) * std::abs(coord(rng));
+			for (int j = 0; j < 4; ++ j) {
+				const double phi = angle(rng);
+				points.push_back(Vec(center[0] + radius * T(cos(phi)), center[1] + radius * T(sin(phi))));
+			}
+		}
+	}
+	return points;
+}
+
+// Whether the floating point determinant of orient2d() in ExactPredicates.c decides the sign,
+// i.e. its first stage, with the same error bound.
+static bool orientCertain(const VectorT<double, 2> &a, const VectorT<double, 2> &b, const VectorT<double, 2> &c)
+{
+	const double epsilon = 1.1102230246251565e-16; // 2^-53
+	const double ccwErrBoundA = (3. + 16. * epsilon) * epsilon;
+	const double detLeft  = (a[0] - c[0]) * (b[1] - c[1]);
+	const double detRight = (a[1] - c[1]) * (b[0] - c[0]);
+	const double det = detLeft - detRight;
+	double detSum;
+	if (detLeft > 0) {
+		if (detRight <= 0)
+			return true;
+		detSum = detLeft + detRight;
+	} else if (detLeft < 0) {
+		if (detRight >= 0)
+			return true;
+		detSum = - detLeft - detRight;
+	} else
+		return true;
+	return fabs(det) >= ccwErrBoundA * detSum;
+}
+
+// The same for incircle().
+static bool inCircleCertain(const VectorT<double, 2> &a, const VectorT<double, 2> &b, const VectorT<double, 2> &c, const VectorT<double, 2> &d)
+{
+	const double epsilon = 1.1102230246251565e-16; // 2^-53
+	const double iccErrBoundA = (10. + 96. * epsilon) * epsilon;
+	const double adx = a[0] - d[0], ady = a[1] - d[1];
+	const double bdx = b[0] - d[0], bdy = b[1] - d[1];
+	const double cdx = c[0] - d[0], cdy = c[1] - d[1];
+	const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	const double cdxady = cdx * ady, adxcdy = adx * cdy;
+	const double adxbdy = adx * bdy, bdxady = bdx * ady;
+	const double alift = adx * adx + ady * ady;
+	const double blift = bdx * bdx + bdy * bdy;
+	const double clift = cdx * cdx + cdy * cdy;
+	const double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+	const double permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift + (fabs(cdxady) + fabs(adxcdy)) * blift +
+		(fabs(adxbdy) + fabs(bdxady)) * clift;
+	return fabs(det) > iccErrBoundA * permanent;
+}
+
+template<typename PREDICATE, typename Vec>
+int callPredicate(PREDICATE &predicate, const Vec *p)
+{
+	if constexpr (std::is_invocable<PREDICATE, Vec, Vec, Vec>::value)
+		return int(predicate(p[0], p[1], p[2]));
+	else
+		return int(predicate(p[0], p[1], p[2], p[3]));
+}
+
+// Nanoseconds per call, repeated over all the cases until at least minSeconds have passed.
+// signs receives the result of each case.
+template<typename PREDICATE, typename T>
+double timePredicate(const std::vector<VectorT<T, 2>> &points, std::vector<int> &signs, const double minSeconds = 0.2)
+{
+	typedef std::chrono::steady_clock Clock;
+	const size_t nCases = points.size() / 4;
+	PREDICATE predicate;
+	signs.resize(nCases);
+	for (size_t i = 0; i < nCases; ++ i)
+		signs[i] = callPredicate(predicate, &points[4 * i]);
+
+	size_t nCalls = 0;
+	long long sink = 0;
+	const Clock::time_point start = Clock::now();
+	double seconds = 0;
+	do {
+		for (size_t i = 0; i < nCases; ++ i)
+			sink += callPredicate(predicate, &points[4 * i]);
+		nCalls += nCases;
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (seconds < minSeconds);
+	// Keeps the calls from being optimized away.
+	if (sink == LLONG_MIN)
+		printf(" ");
+	return 1e9 * seconds / double(nCalls);
+}
+
+// Prints a line of the table. The exact path is the share of the cases which the first stage of an adaptive test
+// cannot decide, all of them for an exact test. The wrong signs are the share of the cases which differ from exactSigns.
+template<typename PREDICATE, typename T>
+void benchPredicate(const char *typeName, const char *name, const InputKind kind, const std::vector<VectorT<T, 2>> &points,
+	const std::vector<int> &exactSigns, const std::vector<char> &uncertain, const bool adaptive, const bool exact)
+{
+	std::vector<int> signs;
+	const double ns = timePredicate<PREDICATE>(points, signs);
+	size_t nUncertain = 0, nWrong = 0;
+	for (size_t i = 0; i < signs.size(); ++ i) {
+		nUncertain += uncertain[i];
+		nWrong += signs[i] != exactSigns[i];
+	}
+	const double nCases = double(signs.size());
+	const double exactPath = exact ? 100. : adaptive ? 100. * double(nUncertain) / nCases : 0.;
+	printf("%-7s %-18s %-26s %9.2f %10.2f%% %10.4f%%\n", typeName, inputName(kind), name, ns, exactPath, 100. * double(nWrong) / nCases);
+}
+
+template<typename T>
+void benchType(const char *typeName, const size_t nCases, std::mt19937_64 &rng)
+{
+	typedef VectorT<T, 2>		Vec;
+	typedef VectorT<double, 2>	Vec2d;
+
+	for (const InputKind kind : { INPUT_RANDOM, INPUT_NEARLY_COLLINEAR, INPUT_NEARLY_COCIRCULAR }) {
+		const std::vector<Vec> points = makeInput<T>(kind, nCases, rng);
+
+		// The references, on the points converted to double exactly.
+		std::vector<int> orientSigns(nCases), inCircleSigns(nCases);
+		std::vector<char> orientUncertain(nCases), inCircleUncertain(nCases);
+		for (size_t i = 0; i < nCases; ++ i) {
+			Vec2d p[4];
+			for (int j = 0; j < 4; ++ j)
+				p[j] = Vec2d(double(points[4 * i + j][0]), double(points[4 * i + j][1]));
+			orientSigns[i]		 = int(Orient2dExact<double>()(p[0], p[1], p[2]));
+			inCircleSigns[i]	 = int(InCircleExact<double>()(p[0], p[1], p[2], p[3]));
+			orientUncertain[i]	 = ! orientCertain(p[0], p[1], p[2]);
+			inCircleUncertain[i] = ! inCircleCertain(p[0], p[1], p[2], p[3]);
+		}
+
+		benchPredicate<Orient2dNaive<T>>	(typeName, "Orient2dNaive",		kind, points, orientSigns,	 orientUncertain,	false, false);
+		benchPredicate<Orient2dAdaptive<T>>	(typeName, "Orient2dAdaptive",	kind, points, orientSigns,	 orientUncertain,	true,  false);
+		// Orient2dExact and InCircleExact pass the coordinates to Shewchuk's code in place, they work on double only.
+		if constexpr (std::is_same<T, double>::value)
+			benchPredicate<Orient2dExact<T>>(typeName, "Orient2dExact",		kind, points, orientSigns,	 orientUncertain,	false, true);
+		benchPredicate<InCircleNaive<T>>	(typeName, "InCircleNaive",		kind, points, inCircleSigns, inCircleUncertain,	false, false);
+		benchPredicate<InCircleAdaptive<T>>	(typeName, "InCircleAdaptive",	kind, points, inCircleSigns, inCircleUncertain,	true,  false);
+		if constexpr (std::is_same<T, double>::value)
+			benchPredicate<InCircleExact<T>>(typeName, "InCircleExact",		kind, points, inCircleSigns, inCircleUncertain,	false, true);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	ExactPredicates::exactinit();
+	ExactPredicates::setFPURoundingTo53Bits();
+
+	const size_t nCases = (argc > 1) ? size_t(strtoull(argv[1], nullptr, 10)) : size_t(1) << 16;
+	if (nCases == 0) {
+		fprintf(stderr, "Usage: %s [number of cases]\n", argv[0]);
+		return 2;
+	}
+	// Fixed seed, so runs on different machines and versions see the same input.
+	std::mt19937_64 rng(20130101);
+
+	printf("%-7s %-18s %-26s %9s %11s %11s\n", "type", "input", "predicate", "ns/call", "exact path", "wrong sign");
+	benchType<float>("float", nCases, rng);
+	benchType<double>("double", nCases, rng);
+	return 0;
+}
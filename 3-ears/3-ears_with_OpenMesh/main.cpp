@@ -15,7 +15,17 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <memory>
+#include <thread>
+#include <array>
+#include <queue>
+#include <algorithm>
 #include <limits.h>
+#include <limits>
+#include <stdint.h>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
 
 #include <iostream>
 #include <iomanip>    // for stream output precision 
@@ -23,8 +33,21 @@
 
 #include <assert.h>
 
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "ExactPredicates.h"
+#include "Predicates.h"
 #include "PolyMesh.h"
+#include "CompactTriMesh.h"
+#include "ThreadPool.h"
+#include "BoundedQueue.h"
+#include "MappedFile.h"
+#include "PolygonFormats.h"
+#include "BufferedWriter.h"
+#include "MeshExport.h"
+#include "MeshSnapshot.h"
 
 using namespace OpenMesh;
 
@@ -33,15 +56,15 @@ using namespace OpenMesh;
 struct Image {
   uint16_t width;  // number of columns
   uint16_t height; // number of rows
-  int size;
-  int sizeInBytes;
+  size_t size;        // up to 65535 * 65535 pixels, more than an int holds
+  size_t sizeInBytes;
   uint8_t * pixels;
 
   float xMin, xMax, yMin, yMax; // viewPort
 
   Image(const uint16_t _width = 500, const uint16_t _height = 500) : width(_width), height(_height)
   {	
-    size = width * height;
+    size = size_t(width) * height;
     sizeInBytes = 3* size;
     pixels = new uint8_t[sizeInBytes];
     xMin = yMin = -2.0f;
@@ -50,8 +73,11 @@ struct Image {
   ~Image() 
   {
     if(pixels) 
-      delete(pixels);
+      delete[] pixels;
   }
+  // The pixels are owned, see AsyncImageWriter for handing them over.
+  Image(const Image&) = delete;
+  Image& operator=(const Image&) = delete;
   // image with [0,0] in the lower left corner
   // x ... column
   // y ... row
@@ -60,7 +86,7 @@ struct Image {
     if( x<0 || y < 0 || x >= width || y >= height )
       return;
 
-    int pos = 3* ((height-y-1) * width + x);
+    const size_t pos = 3* (size_t(height-y-1) * width + x);
     pixels[pos]   = b;
     pixels[pos+1] = g;
     pixels[pos+2] = r;
@@ -153,7 +179,7 @@ struct Image {
   void erase()
   {
     uint8_t * pixelsPtr = pixels;
-    for( int i=0; i<sizeInBytes; i++)
+    for( size_t i=0; i<sizeInBytes; i++)
       *pixelsPtr++ = 0;
   }
   void write(const std::string fileName)
@@ -163,140 +189,113 @@ struct Image {
   }
 };
 
-// stream input, white space separated
-template< class T>
-std::istream & operator>>( std::istream& in, VectorT<T, 2> & p)
+/** Writes images on a thread of its own, so that drawing the next one need not wait for the disk.
+ *  write() takes the pixels out of the image and gives it a buffer of the same size instead, which holds garbage.
+ *  Written buffers are kept for reuse, so drawing and writing frame after frame allocates a few buffers only.
+ */
+class AsyncImageWriter
 {
-  T x,y;
-  in >> x >> y;
-  if( in )
-    p = VectorT<T, 2>(x,y);
-  return in;
-}
-
-// stream output for 2d point in debugging format
-template< class T>
-std::ostream& operator<<( std::ostream& out, const VectorT<T, 2>& p) {
-  out << "Point( " << std::setprecision(18) << p.x << ", " 
-    << std::setprecision(18) << p.y << ')';
-  return out;
-} 
+public:
+  // maxQueued: frames waiting to be written, write() blocks while this many are
+  explicit AsyncImageWriter(const size_t maxQueued = 2) : jobs(maxQueued), thread([this]() { this->writeLoop(); }) {}
+  ~AsyncImageWriter() { finish(); }
 
-enum OrientationType
-{
-  ORIENTATION_UNDEF  = INT_MAX,
-  RIGHT_TURN	= -1,
-  STRAIGHT	= 0,
-  LEFT_TURN	= 1
-};
+  AsyncImageWriter(const AsyncImageWriter&) = delete;
+  AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
 
-// The naive version of the operator as 2x2 determinant ()()-()()
-template <typename T>
-struct Orient2dNaive
-{
-  OrientationType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c)
-  {   
-    T result =  (a[0] - c[0])*(b[1]-c[1]) - (a[1] - c[1])*(b[0]-c[0]);  //PIVOT c
-    
-    if(result > (T)0)
-      return LEFT_TURN;
-    else if (result < (T)0)
-      return RIGHT_TURN;
-    else 
-      return STRAIGHT;
+  void write(Image &image, const std::string &fileName)
+  {
+    Job job;
+    job.pixels.reset(image.pixels);
+    job.width    = image.width;
+    job.height   = image.height;
+    job.fileName = fileName;
+    image.pixels = takeBuffer(image.sizeInBytes).release();
+    if (! jobs.push(std::move(job))) {
+      // finish() has been called, write it here.
+      writeJob(job);
+    }
   }
-};
-
 
-template <typename T>
-struct Orient2dExact
-{
-  OrientationType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c)
-  {    
+  // Wait until all the images are written. Returns false if any of them could not be, those are reported to cerr.
+  bool finish()
+  {
+    jobs.close();
+    if (thread.joinable())
+      thread.join();
+    return ! failed;
+  }
 
-	T result = ExactPredicates::orient2dexact( &a[0], &b[0], &c[0] );  //PIVOT a
+private:
+  struct Job {
+    std::unique_ptr<uint8_t[]>  pixels;
+    uint16_t                    width  = 0;
+    uint16_t                    height = 0;
+    std::string                 fileName;
+  };
 
-    if(result > 0.0)
-      return LEFT_TURN;
-    else if (result < 0.0)
-      return RIGHT_TURN;
-    else 
-      return STRAIGHT;
+  void writeLoop()
+  {
+    for (Job job; jobs.pop(job); )
+      writeJob(job);
   }
-};
 
-
-// Returns true if r is on the extension of the ray starting in q in
-// the direction q-p, i.e., if (q-p)*(r-q) >= 0, and false otherwise.
-// Naive implementation, which is not precise with float / double types,
-// but may deliver more precise results than Extended2dExact if the points are not exactly collinear.
-template< class T>
-struct Extended2dNaive
-{
-  bool operator()(VectorT<T, 2> p, VectorT<T, 2> q, VectorT<T, 2> r)
-  {   
-    return ((q.x-p.x) * (r.x-q.x) >= (p.y-q.y) * (r.y-q.y));
+  void writeJob(Job &job)
+  {
+    const uint8_t pixelDepth = 24;
+    const tga_result result = tga_write_bgr(job.fileName.c_str(), job.pixels.get(), job.width, job.height, pixelDepth);
+    if (result != TGA_NOERR) {
+      std::cerr << "Cannot write " << job.fileName << ": " << tga_error(result) << std::endl;
+      failed = true;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    spare.emplace_back(3 * size_t(job.width) * job.height, std::move(job.pixels));
   }
-};
 
-// Returns true if r is on the extension of the ray starting in q in
-// the direction q-p, i.e., if (q-p)*(r-q) >= 0, and false otherwise.
-// Exact implementation, works only if p, q, r are collinear.
-template< class T>
-struct Extended2dExact
-{
-  bool operator()(VectorT<T, 2> p, VectorT<T, 2> q, VectorT<T, 2> r)
-  {   
-     assert(Orient2dAdaptive<T>()(p, q, r) == STRAIGHT);
-     return ( p.x == q.x ) ?
-       ( (p.y <= q.y) ? (q.y <= r.y) : (q.y >= r.y) ) :
-       ( (p.x <= q.x) ? (q.x <= r.x) : (q.x >= r.x) );
+  std::unique_ptr<uint8_t[]> takeBuffer(const size_t sizeInBytes)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < spare.size(); ++ i)
+      if (spare[i].first == sizeInBytes) {
+        std::unique_ptr<uint8_t[]> buffer = std::move(spare[i].second);
+        spare.erase(spare.begin() + i);
+        return buffer;
+      }
+    return std::unique_ptr<uint8_t[]>(new uint8_t[sizeInBytes]);
   }
-};
 
-enum InsideOutsideType
-{
-  INOUT_UNDEF		= INT_MAX,
-  INOUT_INSIDE		= -1,
-  INOUT_BOUNDARY	= 0,
-  INOUT_OUTSIDE		= 1
+  BoundedQueue<Job>                                           jobs;
+  std::mutex                                                  mutex;
+  std::vector<std::pair<size_t, std::unique_ptr<uint8_t[]>>>  spare;  // written buffers and their sizes
+  std::atomic<bool>                                           failed{false};
+  std::thread                                                 thread;
 };
 
-/// test, if point d is in the circumcircle to points a,b,c
+// stream input, white space separated
 template< class T>
-struct InCircleNaive
-{
-  InsideOutsideType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c, VectorT<T, 2> d)
-  {   
-	  VectorT<T, 2> ad = a - d;
-	  VectorT<T, 2> bd = b - d;
-	  VectorT<T, 2> cd = c - d;
-    T abdet = ad[0] * bd[1] - bd[0] * ad[1];
-	  T bcdet = bd[0] * cd[1] - cd[0] * bd[1];
-	  T cadet = cd[0] * ad[1] - ad[0] * cd[1];
-	  T alift = ad[0] * ad[0] + ad[1] * ad[1];
-	  T blift = bd[0] * bd[0] + bd[1] * bd[1];
-	  T clift = cd[0] * cd[0] + cd[1] * cd[1];
-	  T det = alift * bcdet + blift * cadet + clift * abdet;
-	  return (det > 0) ? INOUT_INSIDE : ((det < 0) ? INOUT_OUTSIDE : INOUT_BOUNDARY);
-  }
-};
+std::istream & operator>>( std::istream& in, VectorT<T, 2> & p)
+{
+  T x,y;
+  in >> x >> y;
+  if( in )
+    p = VectorT<T, 2>(x,y);
+  return in;
+}
 
-/// test, if point d is in the circumcircle to points a,b,c
+// stream output for 2d point in debugging format
 template< class T>
-struct InCircleExact
-{
-  InsideOutsideType operator()(VectorT<T, 2> a, VectorT<T, 2> b, VectorT<T, 2> c, VectorT<T, 2> d)
-  {   
-	 T det = ExactPredicates::incircle(&a[0], &b[0], &c[0], &d[0]);
-	 return (det > 0) ? INOUT_INSIDE : ((det < 0) ? INOUT_OUTSIDE : INOUT_BOUNDARY);
-  }
-};
+std::ostream& operator<<( std::ostream& out, const VectorT<T, 2>& p) {
+  out << "Point( " << std::setprecision(18) << p.x << ", " 
+    << std::setprecision(18) << p.y << ')';
+  return out;
+} 
 
-template<typename T, typename ORIENT, typename EXTENDED, typename INCIRCLE>
+// MESH is PolyMesh_ArrayKernelT or anything offering the same interface, e.g. CompactTriMesh.
+// The triangulation reads no status flags, so the default mesh goes without them, see PolyMesh.h.
+template<typename T, typename ORIENT, typename EXTENDED, typename INCIRCLE, typename MESH = PolyMesh_ArrayKernelT<PolyMeshTraitsFlip<T> > >
 struct Kernel {
   typedef T											FloatType;
-  typedef PolyMesh_ArrayKernelT<PolyMeshTraits<T> >	MeshType;
+  typedef MESH										MeshType;
   typedef ORIENT									Orient;
   typedef EXTENDED									Extended;
   typedef INCIRCLE									InCircle;
@@ -315,55 +314,98 @@ int read_points( const char* filename, OutputIterator points) {
   return read_points( in, points);
 } 
 
-template <class KERNEL, class OutputIterator> 
-int readPoints( std::string inputFileName, OutputIterator points )
+/** The points of a polygon file as loadPoints() reads them. The points of a .bpoly file stored in the float type
+ *  of the kernel are used in place from the mapped file, the others are read into a buffer of its own.
+ */
+template <class KERNEL>
+class PolygonPoints
 {
-  int returnValue;
-  int n = 0;
-
-  std::ifstream inFile( inputFileName + ".txt" );
+public:
+  typedef VectorT<typename KERNEL::FloatType, 2> VecType;
 
-  if ( !inFile.is_open() ) 
+  // See loadPoints(), returns the number of points or -1.
+  int64_t load( const std::string &inputFileName, ThreadPool *pool = nullptr )
   {
-    std::cerr <<  "Cannot open " << inputFileName << std::endl;
-    returnValue = -1;
-  } else {
-    if( !inFile.eof() )
+    first = last = nullptr;
+    buffer.clear();
+    binary.close();
+    if ( hasExtension(inputFileName, ".bpoly") )
     {
-      VectorT<typename KERNEL::FloatType, 2> p;
-      while( inFile >> p[0] && inFile >> p[1] )
+      if ( !binary.open(inputFileName) )
+        return -1;
+      if ( (first = binary.points<typename KERNEL::FloatType>()) != nullptr )
       {
-        *points++ = p;
-        n++;
+        last = first + binary.size();
+        return int64_t(binary.size());
       }
+      binary.close();
     }
-    returnValue = n;
+    const int64_t nPoints = loadPoints<KERNEL>( inputFileName, buffer, pool );
+    first = buffer.data();
+    last  = buffer.data() + buffer.size();
+    return nPoints;
   }
 
-  inFile.close();
+  const VecType* begin() const { return first; }
+  const VecType* end() const { return last; }
+  size_t size() const { return size_t(last - first); }
+  // Whether the points are the ones of the mapped file.
+  bool inPlace() const { return first != nullptr && first != buffer.data(); }
+
+private:
+  BinaryPolygonFile     binary;
+  std::vector<VecType>  buffer;
+  const VecType         *first = nullptr, *last = nullptr;
+};
+
+template <class KERNEL, class OutputIterator> 
+int64_t readPoints( std::string inputFileName, OutputIterator points )
+{
+  // Decoded straight into points.
+  if ( hasExtension(inputFileName, ".qpoly") )
+  {
+    QuantizedPolygonFile quantized;
+    if ( !quantized.open(inputFileName) || !quantized.decode<typename KERNEL::FloatType>(points) )
+      return -1;
+    return int64_t(quantized.size());
+  }
 
+  std::vector<VectorT<typename KERNEL::FloatType, 2>> buffer;
+  const int64_t returnValue = loadPoints<KERNEL>( inputFileName, buffer );
+  std::copy(buffer.begin(), buffer.end(), points);
   return returnValue;
 }
 
+// Writes the points to outputFileName + ".txt", one per line in the shortest form which reads back to the same value,
+// or with binary set to outputFileName + ".bpoly", see writeBinaryPolygon().
 template<class ForwardIterator>
-int writePoints( std::string outputFileName, const ForwardIterator first, const ForwardIterator last )
+int writePoints( std::string outputFileName, const ForwardIterator first, const ForwardIterator last, const bool binary = false )
 { 
   if(first == last)
     return -1;
 
+  if ( binary )
+    return writeBinaryPolygon( outputFileName + ".bpoly", first, last );
+
   int returnValue = 0;
-  std::ofstream outFile( outputFileName + ".txt" );
+  BufferedWriter outFile;
 
-  if ( !outFile.is_open() )  {
+  if ( !outFile.open( outputFileName + ".txt" ) )  {
     std::cerr <<  "Cannot open " << outputFileName + ".txt" << std::endl;
     returnValue = -1;
   } 
   else {
     for( ForwardIterator i = first; i != last; ++i)
     {
-      outFile << std::setprecision(18) << (*i)[0] << " " << (*i)[1] << std::endl;
+      outFile.number( (*i)[0] );
+      outFile.put( ' ' );
+      outFile.number( (*i)[1] );
+      outFile.put( '\n' );
+    }
+    if ( !outFile.close() ) {
+      std::cerr <<  "Cannot write " << outputFileName + ".txt" << std::endl;
+      returnValue = -1;
     }
-    outFile.close();
   }
   return returnValue;
 }
@@ -429,107 +471,865 @@ void printPoints( const ForwardIterator first, const ForwardIterator last )
 		std::cout << "Point( " << std::setprecision(18) << (*i)[0] << ", " << std::setprecision(18) << (*i)[1] << ')' << std::endl;
 }
 
+/** Sum of doubles kept exactly as a nonoverlapping expansion, see Shewchuk, "Adaptive Precision Floating-Point
+ *  Arithmetic and Fast Robust Geometric Predicates": Grow-Expansion with zero elimination. The components are
+ *  sorted by magnitude, so the largest one gives the sign. Zero elimination bounds their number by the exponent
+ *  range, about 40, however many terms are added. Needs the FPU rounding to 53 bits, see ExactPredicates.
+ */
+class ExactSum
+{
+public:
+	void add(double b)
+	{
+		size_t k = 0;
+		for (size_t i = 0; i < components.size(); ++ i) {
+			// Two-Sum, s + error == b + components[i] exactly.
+			const double a = components[i];
+			const double s = a + b;
+			const double bVirtual = s - a;
+			const double aVirtual = s - bVirtual;
+			const double error = (a - aVirtual) + (b - bVirtual);
+			if (error != 0.)
+				components[k ++] = error;
+			b = s;
+		}
+		components.resize(k);
+		if (b != 0.)
+			components.push_back(b);
+	}
+
+	// Adds a * b - c * d, the products are split into their rounded values and errors by fma, which are exact.
+	void addCross(const double a, const double b, const double c, const double d)
+	{
+		const double ab = a * b, cd = c * d;
+		add(fma(a, b, - ab));
+		add(- fma(c, d, - cd));
+		add(ab);
+		add(- cd);
+	}
+
+	int sign() const { return components.empty() ? 0 : ((components.back() > 0.) ? 1 : -1); }
+
+private:
+	std::vector<double> components;
+};
+
+/** Orientation of a simple polygon in O(n).
+ *  The lowest (then leftmost) vertex is always convex, so a single orientation test
+ *  with its neighbours decides the orientation, exactly if KERNEL::Orient is exact.
+ *  Degenerate input (all points collinear around the extreme vertex) falls back to the sign of the signed area,
+ *  which is summed exactly, see ExactSum, as a rounded sum could get it wrong for a nearly degenerate ring.
+ *  @return LEFT_TURN for counterclockwise, RIGHT_TURN for clockwise, STRAIGHT for zero area
+ */
+template<typename KERNEL, typename RandomAccessIterator>
+OrientationType PolygonOrientation( const RandomAccessIterator first, const RandomAccessIterator last )
+{
+	const int n = int(last - first);
+	if (n < 3)
+		return STRAIGHT;
+
+	// Find the lowest vertex, the leftmost one in case of a tie.
+	int iLow = 0;
+	for (int i = 1; i < n; ++ i)
+		if (first[i][1] < first[iLow][1] || (first[i][1] == first[iLow][1] && first[i][0] < first[iLow][0]))
+			iLow = i;
+
+	// Skip duplicates of the extreme vertex.
+	int iPrev = (iLow + n - 1) % n;
+	while (iPrev != iLow && first[iPrev] == first[iLow])
+		iPrev = (iPrev + n - 1) % n;
+	int iNext = (iLow + 1) % n;
+	while (iNext != iLow && first[iNext] == first[iLow])
+		iNext = (iNext + 1) % n;
+
+	OrientationType orientation = typename KERNEL::Orient()(first[iPrev], first[iLow], first[iNext]);
+	if (orientation != STRAIGHT)
+		return orientation;
+
+	// Twice the signed area by the shoelace formula, on the coordinates as given, translating them would round.
+	ExactSum area;
+	for (int i = 0; i < n; ++ i) {
+		const int j = (i + 1 < n) ? i + 1 : 0;
+		area.addCross(double(first[i][0]), double(first[j][1]), double(first[j][0]), double(first[i][1]));
+	}
+	return (area.sign() > 0) ? LEFT_TURN : ((area.sign() < 0) ? RIGHT_TURN : STRAIGHT);
+}
+
+/** Reorder a clockwise polygon in place to be counterclockwise, as expected by the ear cutting.
+ *  The first vertex is kept in place.
+ *  @return true if the polygon has been reversed
+ */
+template<typename KERNEL, typename RandomAccessIterator>
+bool NormalizeOrientation( const RandomAccessIterator first, const RandomAccessIterator last )
+{
+	if (PolygonOrientation<KERNEL>(first, last) != RIGHT_TURN)
+		return false;
+	std::reverse(first + 1, last);
+	return true;
+}
+
+/** Add the polygon [first, last) to the mesh as a single face with its vertices in counterclockwise order,
+ *  the first one kept in place as by NormalizeOrientation(), but without writing to the points, which may be mapped from a file.
+ *  @param[out]  vertices - The vertices of the face in their order
+ *  @param[out]  reversed - If given, receives whether the polygon was clockwise
+ *  @return the face, invalid if the mesh does not take it
+ */
+template<typename KERNEL, typename RandomAccessIterator>
+typename KERNEL::MeshType::FaceHandle AddPolygonFace( typename KERNEL::MeshType &mesh, const RandomAccessIterator first, const RandomAccessIterator last,
+	std::vector<typename KERNEL::MeshType::VertexHandle> &vertices, bool *reversed = nullptr )
+{
+	const bool clockwise = PolygonOrientation<KERNEL>(first, last) == RIGHT_TURN;
+	const size_t n = size_t(last - first);
+	vertices.clear();
+	vertices.reserve(n);
+	for (size_t i = 0; i < n; ++ i)
+		vertices.push_back(mesh.add_vertex(first[(clockwise && i > 0) ? n - i : i]));
+	if (reversed)
+		*reversed = clockwise;
+	return mesh.add_face(vertices);
+}
+
 //****************************************************************************************
 // ======== BEGIN OF SOLUTION - TASK 1-1 ======== //
+/** Triangle (a, b, c) of three consecutive vertices of a counterclockwise polygon, b being the tip of the ear.
+ */
 template<typename POINT, typename ORIENT>
 class PolygonEar
 {
+public:
+	PolygonEar(const POINT &a, const POINT &b, const POINT &c) : a(a), b(b), c(c) {}
+
+	// The tip of an ear has to be a strictly convex vertex.
+	bool isConvex() const { return ORIENT()(a, b, c) == LEFT_TURN; }
+
+	// Inside or on the boundary of the triangle. Any other polygon vertex found here prevents the ear from being cut.
+	bool contains(const POINT &p) const
+	{
+		return ORIENT()(a, b, p) != RIGHT_TURN && ORIENT()(b, c, p) != RIGHT_TURN && ORIENT()(c, a, p) != RIGHT_TURN;
+	}
+
+private:
+	POINT a, b, c;
+};
+
+// Extend [xLo, xHi] by the x range of the segment (p, q) clipped to the row y0 <= y <= y1.
+template<typename VecType>
+void ClipSegmentToRow(const VecType &p, const VecType &q, const double y0, const double y1, double &xLo, double &xHi)
+{
+	const double px = double(p[0]), py = double(p[1]);
+	const double qx = double(q[0]), qy = double(q[1]);
+	if (std::max(py, qy) < y0 || std::min(py, qy) > y1)
+		return;
+	double t0 = 0., t1 = 1.;
+	if (py != qy) {
+		const double ta = (y0 - py) / (qy - py);
+		const double tb = (y1 - py) / (qy - py);
+		t0 = std::max(0., std::min(ta, tb));
+		t1 = std::min(1., std::max(ta, tb));
+	}
+	const double x0 = px + t0 * (qx - px);
+	const double x1 = px + t1 * (qx - px);
+	xLo = std::min(xLo, std::min(x0, x1));
+	xHi = std::max(xHi, std::max(x0, x1));
+}
+
+/** Ear clipping of a simple counterclockwise polygon given as a ring of points.
+ *  Works on a doubly linked list of ring positions only, the mesh is not touched.
+ *  Only a reflex vertex may block an ear, and clipping an ear changes the ear status of its two neighbours only,
+ *  so just these are retested after each cut. The reflex vertices are bucketed in a uniform grid,
+ *  an ear test only visits the cells overlapping the bounding box of the ear. The buffers are kept between calls.
+ */
+template<typename KERNEL>
+class EarClipper
+{
+public:
+	typedef VectorT<typename KERNEL::FloatType, 2>			VecType;
+	typedef PolygonEar<VecType, typename KERNEL::Orient>	Ear;
+
+	// Triangle cut off the polygon, given by positions in the input ring.
+	struct Triangle { int prev, tip, next; };
+
+	/** Clip the ears of the polygon.
+	 *  Without a thread pool, one ear is clipped at a time. With a thread pool, each round clips a maximal set of ears
+	 *  with pairwise disjoint vertex neighbourhoods in parallel, and then retests the neighbours in parallel.
+	 *  The ears of a round are picked in the order of ring positions, so the result does not depend on the number of threads.
+	 *  @return false if no ear was found before the polygon has been reduced to a triangle, which means the input
+	 *          is not simple or is degenerate. triangles() then holds the ears clipped so far.
+	 */
+	bool clip(const VecType *points, const int n, ThreadPool *pool = nullptr)
+	{
+		pts = points;
+		triangles_.clear();
+		if (n < 3)
+			return false;
+
+		ringPrev.resize(n);
+		ringNext.resize(n);
+		reflex.assign(n, 0);
+		ear.assign(n, 0);
+		removed.assign(n, 0);
+		for (int i = 0; i < n; ++ i) {
+			ringPrev[i] = (i + n - 1) % n;
+			ringNext[i] = (i + 1) % n;
+		}
+
+		// Classify all vertices. Testing the ears is the expensive part, each test runs over all reflex vertices.
+		forEach(pool, n, [this](size_t i) { reflex[i] = isReflex(int(i)); }, 4096);
+		buildGrid(n);
+		forEach(pool, n, [this](size_t i) { ear[i] = isEar(int(i)); }, 64);
+
+		const int tip = pool ? clipInRounds(n, *pool) : clipOneByOne(n);
+		if (tip < 0)
+			return false;
+		triangles_.push_back(Triangle{ ringPrev[tip], tip, ringNext[tip] });
+		return true;
+	}
+
+	// n - 2 triangles of a clipped polygon in the order they were cut, the last one being the remaining triangle.
+	const std::vector<Triangle>& triangles() const { return triangles_; }
+
+private:
+	template<typename Fn>
+	static void forEach(ThreadPool *pool, const size_t n, Fn fn, const size_t minChunk)
+	{
+		if (pool)
+			pool->parallelFor(0, n, fn, minChunk);
+		else
+			for (size_t i = 0; i < n; ++ i)
+				fn(i);
+	}
+
+	// Collinear vertices count as reflex, they cannot be a tip, but they may block an ear.
+	bool isReflex(const int v) const
+	{
+		return ! Ear(pts[ringPrev[v]], pts[v], pts[ringNext[v]]).isConvex();
+	}
+
+	// Bucket the initially reflex vertices, about one per cell. Vertices only ever turn from reflex to convex.
+	void buildGrid(const int n)
+	{
+		double xMin, xMax, yMin, yMax;
+		xMin = xMax = double(pts[0][0]);
+		yMin = yMax = double(pts[0][1]);
+		int nReflex = 0;
+		for (int i = 0; i < n; ++ i) {
+			xMin = std::min(xMin, double(pts[i][0]));
+			xMax = std::max(xMax, double(pts[i][0]));
+			yMin = std::min(yMin, double(pts[i][1]));
+			yMax = std::max(yMax, double(pts[i][1]));
+			nReflex += reflex[i];
+		}
+		gridNX = gridNY = std::max(1, int(std::sqrt(double(nReflex))));
+		gridX0 = xMin;
+		gridY0 = yMin;
+		gridScaleX = (xMax > xMin) ? gridNX / (xMax - xMin) : 0.;
+		gridScaleY = (yMax > yMin) ? gridNY / (yMax - yMin) : 0.;
+
+		cellStart.assign(gridNX * gridNY + 1, 0);
+		for (int i = 0; i < n; ++ i)
+			if (reflex[i])
+				++ cellStart[cell(pts[i]) + 1];
+		for (size_t c = 1; c < cellStart.size(); ++ c)
+			cellStart[c] += cellStart[c - 1];
+		cellItems.resize(nReflex);
+		cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+		for (int i = 0; i < n; ++ i)
+			if (reflex[i])
+				cellItems[cellFill[cell(pts[i])] ++] = i;
+	}
+
+	// Monotone in both coordinates, so all points inside a box map to the cells spanned by its corners.
+	int cellX(const double x) const { return std::min(gridNX - 1, std::max(0, int((x - gridX0) * gridScaleX))); }
+	int cellY(const double y) const { return std::min(gridNY - 1, std::max(0, int((y - gridY0) * gridScaleY))); }
+	int cell(const VecType &p) const { return cellY(double(p[1])) * gridNX + cellX(double(p[0])); }
+
+	bool isEar(const int v) const
+	{
+		if (reflex[v])
+			return false;
+		const int prev = ringPrev[v];
+		const int next = ringNext[v];
+		const VecType &a = pts[prev];
+		const VecType &b = pts[v];
+		const VecType &c = pts[next];
+		Ear candidate(a, b, c);
+		const typename KERNEL::FloatType xMin = std::min(a[0], std::min(b[0], c[0]));
+		const typename KERNEL::FloatType xMax = std::max(a[0], std::max(b[0], c[0]));
+		const typename KERNEL::FloatType yMin = std::min(a[1], std::min(b[1], c[1]));
+		const typename KERNEL::FloatType yMax = std::max(a[1], std::max(b[1], c[1]));
+		const int cx0 = cellX(double(xMin)), cx1 = cellX(double(xMax));
+		const int cy0 = cellY(double(yMin)), cy1 = cellY(double(yMax));
+		for (int cy = cy0; cy <= cy1; ++ cy) {
+			// Only visit the cells of this row overlapping the triangle, long thin ears would otherwise scan most of their bounding box.
+			int cxFirst = cx0, cxLast = cx1;
+			if (cy0 < cy1 && cx0 < cx1) {
+				const double margin = 1e-9 * (gridNY / gridScaleY);
+				const double y0 = gridY0 + cy / gridScaleY - margin;
+				const double y1 = gridY0 + (cy + 1) / gridScaleY + margin;
+				double xLo = std::numeric_limits<double>::max(), xHi = - std::numeric_limits<double>::max();
+				ClipSegmentToRow(a, b, y0, y1, xLo, xHi);
+				ClipSegmentToRow(b, c, y0, y1, xLo, xHi);
+				ClipSegmentToRow(c, a, y0, y1, xLo, xHi);
+				if (xLo > xHi)
+					continue;
+				const double marginX = 1e-9 * (gridNX / gridScaleX);
+				cxFirst = std::max(cx0, cellX(xLo - marginX));
+				cxLast  = std::min(cx1, cellX(xHi + marginX));
+			}
+			for (int cx = cxFirst; cx <= cxLast; ++ cx) {
+				const int c = cy * gridNX + cx;
+				for (int k = cellStart[c]; k < cellStart[c + 1]; ++ k) {
+					const int r = cellItems[k];
+					if (removed[r] || ! reflex[r] || r == prev || r == next)
+						continue;
+					const VecType &p = pts[r];
+					if (p[0] < xMin || p[0] > xMax || p[1] < yMin || p[1] > yMax)
+						continue;
+					if (candidate.contains(p))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Unlink the tip v, remember the triangle.
+	void cut(const int v, Triangle &triangle)
+	{
+		const int prev = ringPrev[v];
+		const int next = ringNext[v];
+		triangle = Triangle{ prev, v, next };
+		ringNext[prev] = next;
+		ringPrev[next] = prev;
+		removed[v] = 1;
+	}
+
+	// Returns a vertex of the remaining triangle, or -1 if stuck.
+	int clipOneByOne(const int n)
+	{
+		int v = 0;
+		int remaining = n;
+		int nTested = 0;
+		while (remaining > 3) {
+			if (ear[v]) {
+				triangles_.emplace_back();
+				cut(v, triangles_.back());
+				-- remaining;
+				nTested = 0;
+				const int prev = ringPrev[v];
+				const int next = ringNext[v];
+				reflex[prev] = isReflex(prev);
+				reflex[next] = isReflex(next);
+				ear[prev]    = isEar(prev);
+				ear[next]    = isEar(next);
+				// Continue with the previous vertex, so that an ear created behind is not left for the next lap.
+				v = prev;
+			} else {
+				// Went around the whole ring without finding an ear.
+				if (++ nTested > remaining)
+					return -1;
+				v = ringNext[v];
+			}
+		}
+		return v;
+	}
+
+	// Returns a vertex of the remaining triangle, or -1 if stuck.
+	int clipInRounds(const int n, ThreadPool &pool)
+	{
+		// Current ears sorted by ring position. The ear status of the other vertices does not change in a round
+		// except for the neighbours of the cut ears.
+		candidates.clear();
+		for (int i = 0; i < n; ++ i)
+			if (ear[i])
+				candidates.push_back(i);
+		locked.assign(n, 0);
+
+		int remaining = n;
+		int alive = 0;
+		while (remaining > 3) {
+			// Pick ears greedily, an ear is taken if none of its three vertices is used by an ear taken before.
+			selected.clear();
+			for (int v : candidates) {
+				if (int(selected.size()) == remaining - 3)
+					break;
+				const int prev = ringPrev[v];
+				const int next = ringNext[v];
+				if (locked[prev] || locked[v] || locked[next])
+					continue;
+				locked[prev] = locked[v] = locked[next] = 1;
+				selected.push_back(v);
+			}
+			if (selected.empty())
+				return -1;
+
+			// Cut them. The ears share no vertex, so each one rewrites different links.
+			const size_t first = triangles_.size();
+			triangles_.resize(first + selected.size());
+			pool.parallelFor(0, selected.size(), [this, first](size_t i) { cut(selected[i], triangles_[first + i]); }, 4096);
+			remaining -= int(selected.size());
+
+			// Retest the neighbours, all of them distinct. Reflex flags first, the ear tests read them.
+			affected.clear();
+			for (size_t i = first; i < triangles_.size(); ++ i) {
+				affected.push_back(triangles_[i].prev);
+				affected.push_back(triangles_[i].next);
+			}
+			alive = affected.front();
+			pool.parallelFor(0, affected.size(), [this](size_t i) { reflex[affected[i]] = isReflex(affected[i]); }, 1024);
+			pool.parallelFor(0, affected.size(), [this](size_t i) { ear[affected[i]] = isEar(affected[i]); }, 16);
+
+			// Untouched ears stay ears, merge in the neighbours that became ears.
+			std::sort(affected.begin(), affected.end());
+			affected.erase(std::remove_if(affected.begin(), affected.end(), [this](int v) { return ! ear[v]; }), affected.end());
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](int v) { return locked[v] != 0; }), candidates.end());
+			merged.clear();
+			std::merge(candidates.begin(), candidates.end(), affected.begin(), affected.end(), std::back_inserter(merged));
+			candidates.swap(merged);
+			for (size_t i = first; i < triangles_.size(); ++ i)
+				locked[triangles_[i].prev] = locked[triangles_[i].tip] = locked[triangles_[i].next] = 0;
+		}
+		return alive;
+	}
+
+	const VecType			*pts = nullptr;
+	std::vector<int>		ringPrev, ringNext;
+	std::vector<char>		reflex, ear, removed, locked;
+	// Grid of the reflex vertices in compressed row storage.
+	int						gridNX = 1, gridNY = 1;
+	double					gridX0 = 0., gridY0 = 0., gridScaleX = 0., gridScaleY = 0.;
+	std::vector<int>		cellStart, cellItems, cellFill;
+	std::vector<int>		candidates, selected, affected, merged;
+	std::vector<Triangle>	triangles_;
 };
 // ========  END OF SOLUTION - TASK 1-1  ======== //
 
 
 
-/** The ear cutting procedure
- *  @param[in]   points    - Input, simple polygon
- *  @param[out]  triangles - Indices of triangle vertices - three consecutive vertices form a triangle
+// Collect the boundary of a face, outgoing[i] leads from the i-th vertex to the next one.
+template<typename MeshType, typename VecType>
+void CollectFaceBoundary(const MeshType &mesh, const typename MeshType::FaceHandle fh,
+                         std::vector<typename MeshType::HalfedgeHandle> &outgoing, std::vector<VecType> &ring)
+{
+	outgoing.clear();
+	ring.clear();
+	const typename MeshType::HalfedgeHandle hhFirst = mesh.halfedge_handle(fh);
+	typename MeshType::HalfedgeHandle hh = hhFirst;
+	do {
+		outgoing.push_back(hh);
+		ring.push_back(mesh.point(mesh.from_vertex_handle(hh)));
+		hh = mesh.next_halfedge_handle(hh);
+	} while (hh != hhFirst);
+}
+
+/** Cut triangles off a polygonal face in the given order, each one has to be an ear of what remains.
+ *  The last triangle of a complete triangulation is what remains of the face, it needs no cut.
+ *  @param[in,out]  outgoing  - Face boundary from CollectFaceBoundary(), updated by the cuts
+ *  @param[in]      ears      - Triangles (prev, tip, next) given by positions in outgoing
  */
-// ======== BEGIN OF SOLUTION - TASK 1-2 ======== //
-// Implement the ear cutting procedure
-template<typename KERNEL>
-bool TriangulateFaceByEarCutting(typename KERNEL::MeshType& mesh,
-                                 typename KERNEL::MeshType::FaceHandle	 fh) {
+template<typename MeshType, typename Triangles>
+void InsertEarDiagonals(MeshType &mesh, std::vector<typename MeshType::HalfedgeHandle> &outgoing, const Triangles &ears)
+{
+	const size_t nCuts = std::min(size_t(ears.size()), size_t(std::max(int(outgoing.size()) - 3, 0)));
+	for (size_t i = 0; i < nCuts; ++ i) {
+		const int prev = ears[i].prev, tip = ears[i].tip;
+		// The new halfedge next -> prev closes the triangle (prev, tip, next) as a new face.
+		typename MeshType::HalfedgeHandle hhNew = mesh.insert_edge(outgoing[tip], outgoing[prev]);
+		outgoing[prev] = mesh.opposite_halfedge_handle(hhNew);
+	}
+}
 
-	typedef VectorT<typename KERNEL::FloatType, 2> VecType;
-    typedef typename KERNEL::MeshType	MeshType;
+// Triangle of a small polygon given by vertex positions, see InsertEarDiagonals().
+struct SmallTriangle { unsigned char prev, tip, next; };
 
-    typedef MeshType::HalfedgeHandle	HH;
+// Number of triangulations of a convex polygon with k + 2 vertices.
+constexpr int Catalan(int k) { return (k <= 1) ? 1 : Catalan(k - 1) * 2 * (2 * k - 1) / (k + 1); }
 
-    HH hh1, hh2, hh3, hh4, hh5, new_hh, new_hh_o;
+/** All triangulations of a convex polygon with N vertices, which are also all candidate triangulations of a simple polygon.
+ *  Built once on first use.
+ */
+template<int N>
+struct SmallPolygonTriangulations
+{
+	static const int count = Catalan(N - 2);
+
+	struct Triangulation {
+		// In cutting order, the last one is what remains.
+		std::array<SmallTriangle, N - 2>	triangles;
+		// Diagonal (a, b), triangle (a, c, b) left of it and the apex d of the triangle right of it.
+		unsigned char						diagonals[N - 3][4];
+	};
+	Triangulation items[count];
+
+	static const SmallPolygonTriangulations& get()
+	{
+		static const SmallPolygonTriangulations tables;
+		return tables;
+	}
 
-    hh1 = *mesh.halfedges_begin();
-    hh2 = mesh.prev_halfedge_handle(hh1);
-    hh3 = mesh.prev_halfedge_handle(hh2);
-    hh4 = mesh.prev_halfedge_handle(hh3);
-    hh5 = mesh.prev_halfedge_handle(hh4);
+private:
+	typedef std::vector<std::array<int, 3>> Triangles;
+
+	SmallPolygonTriangulations()
+	{
+		const std::vector<Triangles> all = enumerate(0, N - 1);
+		assert(int(all.size()) == count);
+		for (int k = 0; k < count; ++ k) {
+			Triangulation &item = items[k];
+
+			// Diagonals with the apexes of their two triangles.
+			int apexInside[N][N], apexOutside[N][N];
+			for (int a = 0; a < N; ++ a)
+				for (int b = 0; b < N; ++ b)
+					apexInside[a][b] = apexOutside[a][b] = -1;
+			for (const auto &t : all[k])
+				for (int e = 0; e < 3; ++ e) {
+					const int a = std::min(t[e], t[(e + 1) % 3]), b = std::max(t[e], t[(e + 1) % 3]);
+					const int c = t[(e + 2) % 3];
+					(a < c && c < b ? apexInside : apexOutside)[a][b] = c;
+				}
+			int nDiagonals = 0;
+			for (int a = 0; a < N; ++ a)
+				for (int b = a + 2; b < N; ++ b)
+					if (apexInside[a][b] >= 0 && apexOutside[a][b] >= 0) {
+						unsigned char *diagonal = item.diagonals[nDiagonals ++];
+						diagonal[0] = (unsigned char)a;
+						diagonal[1] = (unsigned char)b;
+						diagonal[2] = (unsigned char)apexInside[a][b];
+						diagonal[3] = (unsigned char)apexOutside[a][b];
+					}
+			assert(nDiagonals == N - 3);
+
+			// Peel the ears, a triangle is an ear once two of its sides are on the remaining ring.
+			int ringPrev[N], ringNext[N];
+			for (int i = 0; i < N; ++ i) {
+				ringPrev[i] = (i + N - 1) % N;
+				ringNext[i] = (i + 1) % N;
+			}
+			std::vector<char> used(N - 2, 0);
+			for (int cut = 0; cut < N - 2; ++ cut)
+				for (int i = 0; i < N - 2; ++ i) {
+					const auto &t = all[k][i];
+					int tip = -1;
+					for (int r = 0; r < 3; ++ r)
+						if (ringPrev[t[(r + 1) % 3]] == t[r] && ringNext[t[(r + 1) % 3]] == t[(r + 2) % 3])
+							tip = t[(r + 1) % 3];
+					if (used[i] || tip < 0)
+						continue;
+					used[i] = 1;
+					item.triangles[cut] = SmallTriangle{ (unsigned char)ringPrev[tip], (unsigned char)tip, (unsigned char)ringNext[tip] };
+					ringNext[ringPrev[tip]] = ringNext[tip];
+					ringPrev[ringNext[tip]] = ringPrev[tip];
+					break;
+				}
+		}
+	}
 
-    int mode = 3;
+	// Triangulations of the vertices i .. j, each triangle counterclockwise.
+	static std::vector<Triangles> enumerate(const int i, const int j)
+	{
+		std::vector<Triangles> result;
+		if (j - i < 2) {
+			result.push_back(Triangles());
+			return result;
+		}
+		for (int k = i + 1; k < j; ++ k)
+			for (const Triangles &left : enumerate(i, k))
+				for (const Triangles &right : enumerate(k, j)) {
+					Triangles t(left);
+					t.insert(t.end(), right.begin(), right.end());
+					t.push_back(std::array<int, 3>{{ i, k, j }});
+					result.push_back(t);
+				}
+		return result;
+	}
+};
 
-    switch (mode) {
-		// CW, CW
-		case 0: 
-			new_hh = mesh.insert_edge(hh1, hh3);
-			new_hh = mesh.insert_edge(hh1, hh2);
-			break;
-		// CW, CCW
-		case 1: 
-			new_hh = mesh.insert_edge(hh1, hh3);
-			new_hh = mesh.insert_edge(hh3, new_hh);
-			break;
-		// CCW, CW
-		case 2: 
-			new_hh = mesh.insert_edge(hh4, hh5);
-			new_hh = mesh.insert_edge(hh1, hh2);
-			break;
-		// CCW, CCW
-		case 3: 
-			new_hh = mesh.insert_edge(hh4, hh5);
-			new_hh_o = mesh.opposite_halfedge_handle(new_hh);
-			new_hh = mesh.insert_edge(hh3, new_hh_o);
-			break;
-		default: 
-			std::cout << "default" << std::endl;
+/** Constrained Delaunay triangulation of a simple counterclockwise polygon with N vertices by trying all candidates.
+ *  A candidate is a triangulation of the polygon if all its triangles are counterclockwise, since their areas then add up
+ *  to the area of the polygon without any overlap. The first candidate with no diagonal failing the incircle test is taken,
+ *  or the first valid one if an inexact kernel finds none.
+ *  @return false if no candidate is valid, which means the polygon is not simple, the face is left untouched then
+ */
+template<typename KERNEL, int N, typename MeshType, typename VecType>
+bool TriangulateSmallFace(MeshType &mesh, std::vector<typename MeshType::HalfedgeHandle> &outgoing, const VecType *p)
+{
+	typedef SmallPolygonTriangulations<N> Tables;
+	const Tables &tables = Tables::get();
+
+	// Orientations of all the triples on demand, -2 for not known yet.
+	signed char orientation[N][N][N];
+	std::fill(&orientation[0][0][0], &orientation[0][0][0] + N * N * N, (signed char)(-2));
+	auto isLeftTurn = [&orientation, p](const SmallTriangle &t) {
+		signed char &o = orientation[t.prev][t.tip][t.next];
+		if (o == -2)
+			o = (signed char)typename KERNEL::Orient()(p[t.prev], p[t.tip], p[t.next]);
+		return o == LEFT_TURN;
+	};
+
+	int chosen = -1;
+	for (int k = 0; k < Tables::count; ++ k) {
+		const typename Tables::Triangulation &item = tables.items[k];
+		bool valid = true;
+		for (int i = 0; valid && i < N - 2; ++ i)
+			valid = isLeftTurn(item.triangles[i]);
+		if (! valid)
+			continue;
+		if (chosen < 0)
+			chosen = k;
+		bool delaunay = true;
+		for (int i = 0; delaunay && i < N - 3; ++ i) {
+			const unsigned char *d = item.diagonals[i];
+			delaunay = typename KERNEL::InCircle()(p[d[0]], p[d[2]], p[d[1]], p[d[3]]) != INOUT_INSIDE;
+		}
+		if (delaunay) {
+			chosen = k;
 			break;
-    }
+		}
+	}
+	if (chosen < 0)
+		return false;
+	InsertEarDiagonals(mesh, outgoing, tables.items[chosen].triangles);
+	return true;
+}
 
+// Diagonal of a counterclockwise quad, 0 for p0-p2, 1 for p1-p3 or -1 if neither is inside.
+// A quad takes one incircle test to choose the Delaunay diagonal, if both diagonals are inside.
+template<typename KERNEL, typename VecType>
+int QuadDiagonal(const VecType *p)
+{
+	typename KERNEL::Orient orient;
+	const bool valid02 = orient(p[0], p[1], p[2]) == LEFT_TURN && orient(p[0], p[2], p[3]) == LEFT_TURN;
+	const bool valid13 = orient(p[1], p[2], p[3]) == LEFT_TURN && orient(p[1], p[3], p[0]) == LEFT_TURN;
+	if (! valid02 && ! valid13)
+		return -1;
+	return (! valid02 || (valid13 && typename KERNEL::InCircle()(p[0], p[1], p[2], p[3]) == INOUT_INSIDE)) ? 1 : 0;
+}
 
-    // parse edges
-    int i = 1;
-    for (auto it = mesh.halfedges_begin(); it != mesh.halfedges_end(); ++it) {
-		VecType p_s = mesh.point(mesh.from_vertex_handle(*it));  
-		VecType p_e = mesh.point(mesh.to_vertex_handle(*it));
-        if (!mesh.is_boundary(*it)) {
-            std::cout << "Edge " << i << " is inner" << std::endl;
-			std::cout << "     [" << p_s[0] << ", " << p_s[1] << "]" << std::endl;
-            std::cout << " --> [" << p_e[0] << ", " << p_e[1] << "]" << std::endl;
-        }
-        else if (mesh.is_boundary(*it)) {
-            std::cout << "Edge " << i << " is outer" << std::endl;
-			std::cout << "     [" << p_s[0] << ", " << p_s[1] << "]" << std::endl;
-            std::cout << " --> [" << p_e[0] << ", " << p_e[1] << "]" << std::endl;
-        }
-        i++;
-    }
+template<typename KERNEL, typename MeshType, typename VecType>
+bool TriangulateQuad(MeshType &mesh, std::vector<typename MeshType::HalfedgeHandle> &outgoing, const VecType *p)
+{
+	const int diagonal = QuadDiagonal<KERNEL>(p);
+	if (diagonal < 0)
+		return false;
+	const std::array<SmallTriangle, 1> ear = {{ diagonal ? SmallTriangle{ 1, 2, 3 } : SmallTriangle{ 0, 1, 2 } }};
+	InsertEarDiagonals(mesh, outgoing, ear);
+	return true;
+}
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+// Vector of doubles, one quad per lane. The lanes of column(p, k) are p[k], p[k + 8], p[k + 16] ...,
+// i.e. the k-th coordinate of consecutive quads. Comparisons return one bit per lane.
+#if defined(__AVX512F__)
+struct SimdDouble
+{
+	typedef __m512d V;
+	enum { lanes = 8 };
+	static V set1(const double a) { return _mm512_set1_pd(a); }
+	static V column(const double *p, const int k) { return _mm512_i64gather_pd(_mm512_setr_epi64(0, 8, 16, 24, 32, 40, 48, 56), p + k, 8); }
+	static V add(const V a, const V b) { return _mm512_add_pd(a, b); }
+	static V sub(const V a, const V b) { return _mm512_sub_pd(a, b); }
+	static V mul(const V a, const V b) { return _mm512_mul_pd(a, b); }
+	static V abs(const V a) { return _mm512_abs_pd(a); }
+	static unsigned greater(const V a, const V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+	static unsigned greaterEqual(const V a, const V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+};
+#else
+struct SimdDouble
+{
+	typedef __m256d V;
+	enum { lanes = 4 };
+	static V set1(const double a) { return _mm256_set1_pd(a); }
+	static V column(const double *p, const int k) { return _mm256_i64gather_pd(p + k, _mm256_setr_epi64x(0, 8, 16, 24), 8); }
+	static V add(const V a, const V b) { return _mm256_add_pd(a, b); }
+	static V sub(const V a, const V b) { return _mm256_sub_pd(a, b); }
+	static V mul(const V a, const V b) { return _mm256_mul_pd(a, b); }
+	static V abs(const V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+	static unsigned greater(const V a, const V b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ)); }
+	static unsigned greaterEqual(const V a, const V b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GE_OQ)); }
+};
+#endif
+
+// Floating point orient2d and incircle of all the lanes with the static error bounds of Shewchuk's adaptive predicates,
+// see "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates". The sign is only
+// trusted in the lanes of the certain mask, the other lanes need the exact predicates.
+struct SimdFilteredPredicates
+{
+	typedef SimdDouble S;
+	typedef S::V V;
+
+	static constexpr double epsilon = 1.1102230246251565e-16; // 2^-53
+	static constexpr double ccwErrBoundA = (3. + 16. * epsilon) * epsilon;
+	static constexpr double iccErrBoundA = (10. + 96. * epsilon) * epsilon;
+
+	// positive ... lanes with a left turn
+	static void orient(const V ax, const V ay, const V bx, const V by, const V cx, const V cy, unsigned &positive, unsigned &certain)
+	{
+		const V detLeft  = S::mul(S::sub(ax, cx), S::sub(by, cy));
+		const V detRight = S::mul(S::sub(ay, cy), S::sub(bx, cx));
+		const V det      = S::sub(detLeft, detRight);
+		const V errBound = S::mul(S::set1(ccwErrBoundA), S::add(S::abs(detLeft), S::abs(detRight)));
+		positive = S::greater(det, S::set1(0.));
+		certain  = S::greaterEqual(S::abs(det), errBound);
+	}
+
+	// inside ... lanes with d inside the circumcircle of the counterclockwise a, b, c
+	static void inCircle(const V ax, const V ay, const V bx, const V by, const V cx, const V cy, const V dx, const V dy,
+		unsigned &inside, unsigned &certain)
+	{
+		const V adx = S::sub(ax, dx), ady = S::sub(ay, dy);
+		const V bdx = S::sub(bx, dx), bdy = S::sub(by, dy);
+		const V cdx = S::sub(cx, dx), cdy = S::sub(cy, dy);
+		const V bdxcdy = S::mul(bdx, cdy), cdxbdy = S::mul(cdx, bdy);
+		const V cdxady = S::mul(cdx, ady), adxcdy = S::mul(adx, cdy);
+		const V adxbdy = S::mul(adx, bdy), bdxady = S::mul(bdx, ady);
+		const V alift  = S::add(S::mul(adx, adx), S::mul(ady, ady));
+		const V blift  = S::add(S::mul(bdx, bdx), S::mul(bdy, bdy));
+		const V clift  = S::add(S::mul(cdx, cdx), S::mul(cdy, cdy));
+		const V det = S::add(S::add(
+			S::mul(alift, S::sub(bdxcdy, cdxbdy)),
+			S::mul(blift, S::sub(cdxady, adxcdy))),
+			S::mul(clift, S::sub(adxbdy, bdxady)));
+		const V permanent = S::add(S::add(
+			S::mul(S::add(S::abs(bdxcdy), S::abs(cdxbdy)), alift),
+			S::mul(S::add(S::abs(cdxady), S::abs(adxcdy)), blift)),
+			S::mul(S::add(S::abs(adxbdy), S::abs(bdxady)), clift));
+		inside  = S::greater(det, S::set1(0.));
+		certain = S::greater(S::abs(det), S::mul(S::set1(iccErrBoundA), permanent));
+	}
+};
+
+// Diagonals of the quads in blocks of SimdDouble::lanes, see QuadDiagonal(). The quads of uncertain lanes
+// are decided by the predicates of KERNEL. Returns the number of quads done, the rest does not fill a block.
+template<typename KERNEL, typename Emit>
+size_t QuadDiagonalsSimd(const VectorT<double, 2> *points, const size_t nQuads, Emit &emit)
+{
+	static_assert(sizeof(VectorT<double, 2>) == 2 * sizeof(double), "Points have to be stored as consecutive coordinates");
+	typedef SimdDouble S;
+	typedef SimdFilteredPredicates F;
+	const unsigned allLanes = (1u << S::lanes) - 1;
+
+	size_t q = 0;
+	for (; q + S::lanes <= nQuads; q += S::lanes) {
+		const double *base = &points[4 * q][0];
+		const S::V x0 = S::column(base, 0), y0 = S::column(base, 1);
+		const S::V x1 = S::column(base, 2), y1 = S::column(base, 3);
+		const S::V x2 = S::column(base, 4), y2 = S::column(base, 5);
+		const S::V x3 = S::column(base, 6), y3 = S::column(base, 7);
+		unsigned left012, left023, left123, left130, inside;
+		unsigned certain012, certain023, certain123, certain130, certainInside;
+		F::orient(x0, y0, x1, y1, x2, y2, left012, certain012);
+		F::orient(x0, y0, x2, y2, x3, y3, left023, certain023);
+		F::orient(x1, y1, x2, y2, x3, y3, left123, certain123);
+		F::orient(x1, y1, x3, y3, x0, y0, left130, certain130);
+		F::inCircle(x0, y0, x1, y1, x2, y2, x3, y3, inside, certainInside);
+		const unsigned valid02 = left012 & left023;
+		const unsigned valid13 = left123 & left130;
+		// The incircle test only matters if both diagonals are inside.
+		const unsigned certain = certain012 & certain023 & certain123 & certain130 & (certainInside | ~(valid02 & valid13)) & allLanes;
+		const unsigned use13   = ~valid02 | (valid13 & inside);
+		const unsigned none    = ~(valid02 | valid13);
+		for (int lane = 0; lane < S::lanes; ++ lane) {
+			const unsigned bit = 1u << lane;
+			if (certain & bit)
+				emit(q + lane, (none & bit) ? -1 : ((use13 & bit) ? 1 : 0));
+			else
+				emit(q + lane, QuadDiagonal<KERNEL>(points + 4 * (q + lane)));
+		}
+	}
+	return q;
+}
+#endif
+
+template<typename KERNEL, typename T, typename Emit>
+size_t QuadDiagonalsSimd(const VectorT<T, 2> *, const size_t, Emit &)
+{
+	return 0;
+}
+
+/** Delaunay triangulation of many quads at once, e.g. of the cells of gridded data.
+ *  Compiled with AVX2 or AVX-512 (-mavx2, -mavx512f or -march=native), 4 resp. 8 quads of doubles are decided
+ *  in vector registers with filtered predicates, otherwise and for the quads of uncertain lanes the predicates of KERNEL are used.
+ *  @param[in]   points    - 4 * nQuads points, the counterclockwise quads one after another
+ *  @param[out]  triangles - 6 * nQuads indices into points, two counterclockwise triangles per quad
+ *  @return number of quads with no diagonal inside, their triangles are left degenerate
+ */
+template<typename KERNEL>
+size_t TriangulateQuadBatch(const VectorT<typename KERNEL::FloatType, 2> *points, const size_t nQuads, uint32_t *triangles)
+{
+	static const unsigned char corners[2][6] = { { 0, 1, 2, 0, 2, 3 }, { 1, 2, 3, 1, 3, 0 } };
+	size_t nFailed = 0;
+	auto emit = [triangles, &nFailed](const size_t q, const int diagonal) {
+		uint32_t *t = triangles + 6 * q;
+		const uint32_t first = uint32_t(4 * q);
+		if (diagonal < 0) {
+			std::fill(t, t + 6, first);
+			++ nFailed;
+		} else
+			for (int i = 0; i < 6; ++ i)
+				t[i] = first + corners[diagonal][i];
+	};
+	for (size_t q = QuadDiagonalsSimd<KERNEL>(points, nQuads, emit); q < nQuads; ++ q)
+		emit(q, QuadDiagonal<KERNEL>(points + 4 * q));
+	return nFailed;
+}
+
+// Buffers of the ear cutting and of the flipping, to be reused by the caller when triangulating many polygons.
+template<typename KERNEL>
+struct TriangulationScratch
+{
+	typedef typename KERNEL::MeshType MeshType;
 
-    // parse vertices
-    i = 0;
-    for (auto it = mesh.vertices_begin(); it != mesh.vertices_end(); ++it) { 
-        VecType point = mesh.point(*it);
-        std::cout << "Vertex " << i << ": [" << point[0] << ", " << point[1] << "]" << std::endl;
-
-        std::vector<OpenMesh::VertexHandle> opposite_vertices;
-        // iterate over all outgoing halfedges
-        for (auto heh : mesh.voh_range(*it))
-        {
-            // navigate to the opposite vertex and store it in the vector
-            typename MeshType::VertexHandle vh = mesh.to_vertex_handle(mesh.opposite_halfedge_handle(mesh.next_halfedge_handle(heh)));
-			VecType point = mesh.point(vh);
-            std::cout << "[" << point[0] << ", " << point[1] << "] ";
-        }
-        std::cout << std::endl;
-        i++;
-	}
-
-    return true;
+	std::vector<typename MeshType::HalfedgeHandle>	outgoing;
+	std::vector<VectorT<typename KERNEL::FloatType, 2>>	ring;
+	EarClipper<KERNEL>								clipper;
+	std::vector<typename MeshType::EdgeHandle>		edges;
+	std::vector<char>								queued;
+};
+
+/** The pool to clip the ears of a polygon of n vertices on, see EarClipper::clip(), or nullptr to clip one ear at a time.
+ *  Each round costs a synchronization of the pool, which is not won back on a single thread or a small polygon.
+ *  The default threshold is the smallest piece of TriangulateFaceByDomainDecomposition().
+ */
+inline ThreadPool* EarClippingPool(ThreadPool *pool, const size_t n, const size_t minParallelSize = 4096)
+{
+	return (pool != nullptr && pool->size() > 1 && n >= minParallelSize) ? pool : nullptr;
+}
+
+/** The ear cutting procedure
+ *  Cuts the polygonal face into triangles by inserting the diagonals of the clipped ears.
+ *  @param[in,out]  mesh    - Mesh containing the face, a simple counterclockwise polygon
+ *  @param[in]      fh      - The face to be triangulated
+ *  @param[in]      pool    - If given, the ears are clipped in parallel rounds, see EarClipper::clip()
+ *  @param[in,out]  scratch - If given, its buffers are used instead of allocating new ones
+ *  @return false if the face could not be triangulated completely
+ */
+// ======== BEGIN OF SOLUTION - TASK 1-2 ======== //
+template<typename KERNEL>
+bool TriangulateFaceByEarCutting(typename KERNEL::MeshType& mesh,
+                                 typename KERNEL::MeshType::FaceHandle	 fh,
+                                 ThreadPool *pool = nullptr,
+                                 TriangulationScratch<KERNEL> *scratch = nullptr) {
+
+	TriangulationScratch<KERNEL> local;
+	TriangulationScratch<KERNEL> &buffers = scratch ? *scratch : local;
+
+	CollectFaceBoundary(mesh, fh, buffers.outgoing, buffers.ring);
+
+	// Small polygons are triangulated by unrolled routines, which give the constrained Delaunay triangulation right away.
+	switch (buffers.ring.size()) {
+	case 3: return true;
+	case 4: return TriangulateQuad<KERNEL>(mesh, buffers.outgoing, buffers.ring.data());
+	case 5: return TriangulateSmallFace<KERNEL, 5>(mesh, buffers.outgoing, buffers.ring.data());
+	case 6: return TriangulateSmallFace<KERNEL, 6>(mesh, buffers.outgoing, buffers.ring.data());
+	case 7: return TriangulateSmallFace<KERNEL, 7>(mesh, buffers.outgoing, buffers.ring.data());
+	case 8: return TriangulateSmallFace<KERNEL, 8>(mesh, buffers.outgoing, buffers.ring.data());
+	default: break;
+	}
+
+	const bool complete = buffers.clipper.clip(buffers.ring.data(), int(buffers.ring.size()), pool);
+	InsertEarDiagonals(mesh, buffers.outgoing, buffers.clipper.triangles());
+	return complete;
 };
 // ========  END OF SOLUTION - TASK 1-2  ======== //
 
@@ -592,20 +1392,1477 @@ void FlipDiagonal(MeshType &mesh, typename MeshType::HalfedgeHandle hh)
 	// mesh.adjust_outgoing_halfedge(vhEnd);
 }
 
-// Expects the mesh to be triangular.
+/** Lawson's flipping of the given edges.
+ *  An inner edge is illegal if the vertex opposite to it in one triangle lies inside the circumcircle of the other one.
+ *  It is flipped and the four edges of its quad are rechecked. Boundary edges are constraints and are never flipped.
+ *  @param[in,out]   mesh  - Triangulation
+ *  @param[in,out]   edges - Edges to be checked, used as the work stack and empty on return
+ *  @param[out]      queued - Scratch flags, one per edge
+ *  @param[in]       constrained - If given, one flag per edge, the flagged inner edges are not flipped either
+ *  @return number of flips
+ */
 template<typename KERNEL>
-bool MakeDelaunayByDiagonalFlipping(typename KERNEL::MeshType &mesh)
+size_t LegalizeEdges(typename KERNEL::MeshType &mesh, std::vector<typename KERNEL::MeshType::EdgeHandle> &edges,
+                     std::vector<char> &queued, const std::vector<char> *constrained = nullptr)
 {
 	typedef typename KERNEL::MeshType	MeshType;
+	typedef typename MeshType::HalfedgeHandle HH;
+
+	queued.assign(mesh.n_edges(), 0);
+	for (auto eh : edges)
+		queued[eh.idx()] = 1;
+
+	size_t nFlips = 0;
+	while (! edges.empty()) {
+		const typename MeshType::EdgeHandle eh = edges.back();
+		edges.pop_back();
+		queued[eh.idx()] = 0;
+		if (mesh.is_boundary(eh) || (constrained && (*constrained)[eh.idx()]))
+			continue;
+
+		// Triangle (a, b, c) left of hh, d opposite to it across hh.
+		const HH hh		  = mesh.halfedge_handle(eh, 0);
+		const HH hhOpposite = mesh.opposite_halfedge_handle(hh);
+		const typename MeshType::Point &a = mesh.point(mesh.from_vertex_handle(hh));
+		const typename MeshType::Point &b = mesh.point(mesh.to_vertex_handle(hh));
+		const typename MeshType::Point &c = mesh.point(mesh.to_vertex_handle(mesh.next_halfedge_handle(hh)));
+		const typename MeshType::Point &d = mesh.point(mesh.to_vertex_handle(mesh.next_halfedge_handle(hhOpposite)));
+		if (typename KERNEL::InCircle()(a, b, c, d) != INOUT_INSIDE)
+			continue;
+
+		FlipDiagonal(mesh, hh);
+		++ nFlips;
+		const HH quad[4] = {
+			mesh.next_halfedge_handle(hh), mesh.next_halfedge_handle(mesh.next_halfedge_handle(hh)),
+			mesh.next_halfedge_handle(hhOpposite), mesh.next_halfedge_handle(mesh.next_halfedge_handle(hhOpposite)) };
+		for (const HH &hhQuad : quad) {
+			const typename MeshType::EdgeHandle ehQuad = mesh.edge_handle(hhQuad);
+			if (! queued[ehQuad.idx()]) {
+				queued[ehQuad.idx()] = 1;
+				edges.push_back(ehQuad);
+			}
+		}
+	}
+	return nFlips;
+}
 
+// Expects the mesh to be triangular. If given, the buffers of scratch are used instead of allocating new ones,
+// and the edges flagged in constrained are kept, e.g. the constraints of a mesh loaded by loadMeshSnapshot().
+// nFlips receives the number of flips if given.
+template<typename KERNEL>
+bool MakeDelaunayByDiagonalFlipping(typename KERNEL::MeshType &mesh, TriangulationScratch<KERNEL> *scratch = nullptr,
+                                    const std::vector<char> *constrained = nullptr, size_t *nFlips = nullptr)
+{
 	// Now flip the new diagonals iteratively to satisfy Delaunay criteria.
 // ======== BEGIN OF SOLUTION - TASK 2-1 ======== //
+	TriangulationScratch<KERNEL> local;
+	TriangulationScratch<KERNEL> &buffers = scratch ? *scratch : local;
+	buffers.edges.clear();
+	for (auto it = mesh.edges_begin(); it != mesh.edges_end(); ++ it)
+		if (! mesh.is_boundary(*it))
+			buffers.edges.push_back(*it);
+	const size_t flips = LegalizeEdges<KERNEL>(mesh, buffers.edges, buffers.queued, constrained);
+	if (nFlips)
+		*nFlips = flips;
 // ========  END OF SOLUTION - TASK 2-1  ======== //
 	return true;
 }
 
+// Remove all items of a mesh but keep the memory. OpenMesh versions with clean_keep_reservation() free the memory in clean().
+template<typename MeshType>
+auto ClearMesh(MeshType &mesh, int) -> decltype(mesh.clean_keep_reservation(), void())
+{
+	mesh.clean_keep_reservation();
+}
+template<typename MeshType>
+void ClearMesh(MeshType &mesh, long)
+{
+	mesh.clean();
+}
+
+/** Constrained Delaunay triangulation of many small polygons one after another, e.g. millions of building outlines.
+ *  The mesh and all the buffers are cleared between polygons but keep their capacity, so once they have grown
+ *  to the largest polygon no more memory is allocated, provided the mesh does not allocate in add_face() itself
+ *  (CompactTriMesh does not).
+ */
+template<typename KERNEL>
+class PolygonTriangulator
+{
+public:
+	typedef typename KERNEL::MeshType				MeshType;
+	typedef VectorT<typename KERNEL::FloatType, 2>	VecType;
+
+	/** Triangulate the polygon given by the points [first, last), in either orientation.
+	 *  The points are read in place, see AddPolygonFace().
+	 *  The result is in mesh() until the next call, with the vertices in counterclockwise order, see NormalizeOrientation().
+	 *  @param[in]  delaunay - Flip the triangulation to a constrained Delaunay one
+	 *  @return false if the polygon is not simple or is degenerate
+	 */
+	template<typename RandomAccessIterator>
+	bool triangulate(const RandomAccessIterator first, const RandomAccessIterator last, const bool delaunay = true, ThreadPool *pool = nullptr)
+	{
+		ClearMesh(mesh_, 0);
+		nPoints = size_t(last - first);
+		reversed = false;
+		if (nPoints < 3)
+			return false;
+		const typename MeshType::FaceHandle fh = AddPolygonFace<KERNEL>(mesh_, first, last, vertices, &reversed);
+		if (! fh.is_valid())
+			return false;
+
+		const bool complete = TriangulateFaceByEarCutting<KERNEL>(mesh_, fh, pool, &scratch);
+		if (complete && delaunay)
+			legalize();
+		return complete;
+	}
+
+	// Flip a complete triangulation of triangulate(..., false) to a constrained Delaunay one.
+	void legalize() { MakeDelaunayByDiagonalFlipping<KERNEL>(mesh_, &scratch); }
+
+	const MeshType& mesh() const { return mesh_; }
+
+	// Position in the input polygon of the vertex vh of mesh().
+	int inputIndex(const typename MeshType::VertexHandle vh) const
+	{
+		return (reversed && vh.idx() > 0) ? int(nPoints) - vh.idx() : vh.idx();
+	}
+
+private:
+	MeshType										mesh_;
+	size_t											nPoints = 0;
+	std::vector<typename MeshType::VertexHandle>	vertices;
+	TriangulationScratch<KERNEL>					scratch;
+	bool											reversed = false;
+};
+
+// Counts of a run of TriangulateMultiPolygonFile().
+struct MultiPolygonResult
+{
+	bool	opened		= false;	// the input is a valid .mpoly file, so a failure was in writing
+	size_t	nPolygons	= 0;
+	size_t	nPoints		= 0;
+	size_t	nFailed		= 0;		// rings which got no triangles
+};
+
+/** Triangulate all the rings of a .mpoly file one after another, see MultiPolygonFile and PolygonTriangulator.
+ *  The rings stored in the float type of the kernel are read in place from the mapped file.
+ *  Consecutive quads, e.g. the cells of gridded data, are triangulated in batches by TriangulateQuadBatch(),
+ *  which gives each one its Delaunay diagonal as the ear cutting of a single quad does.
+ *  The triangles are written to outputFileName, usually name.tri, as three uint32_t indices into the points
+ *  of all the rings, nothing is written if it is empty. A ring which cannot be triangulated completely is reported and gets no triangles.
+ *  @param[in]  triangulator - If given, its mesh and buffers are used, e.g. those of a batch thread
+ *  @param[out]  result - If given, receives the counts of the run
+ *  @return number of triangles written, or -1 if a file cannot be read or written
+ */
+template<typename KERNEL>
+long long TriangulateMultiPolygonFile(const std::string &inputFileName, const std::string &outputFileName, const bool delaunay = true,
+	PolygonTriangulator<KERNEL> *triangulator = nullptr, MultiPolygonResult *result = nullptr)
+{
+	typedef typename KERNEL::FloatType		FloatType;
+	typedef typename KERNEL::MeshType		MeshType;
+	typedef VectorT<FloatType, 2>			VecType;
+
+	MultiPolygonResult counts;
+	if (result == nullptr)
+		result = &counts;
+	*result = MultiPolygonResult();
+	MultiPolygonFile input;
+	if (! input.open(inputFileName))
+		return -1;
+	const size_t nPoints = (input.size() > 0) ? input.firstPoint(input.size() - 1) + input.polygonSize(input.size() - 1) : 0;
+	if (nPoints > UINT32_MAX) {
+		std::cerr << "Error: " << inputFileName << ": too many points for 32 bit indices" << std::endl;
+		return -1;
+	}
+	result->opened		= true;
+	result->nPolygons	= input.size();
+	result->nPoints		= nPoints;
+	BufferedWriter out;
+	if (! outputFileName.empty() && ! out.open(outputFileName)) {
+		std::cerr << "Cannot open " << outputFileName << std::endl;
+		return -1;
+	}
+
+	// Quads are collected in batches of this many, oriented counterclockwise.
+	const size_t maxQuads = 4096;
+	std::vector<VecType>		quads;
+	std::vector<char>			quadReversed;
+	std::vector<uint32_t>		quadTriangles;
+
+	PolygonTriangulator<KERNEL>	ownTriangulator;
+	if (triangulator == nullptr)
+		triangulator = &ownTriangulator;
+	std::vector<VecType>		converted;
+	long long					nTriangles = 0;
+	size_t						nFailed = 0;
+	for (size_t i = 0; i < input.size(); ++ i) {
+		if (input.polygonSize(i) == 4) {
+			size_t nQuads = 1;
+			while (nQuads < maxQuads && i + nQuads < input.size() && input.polygonSize(i + nQuads) == 4)
+				++ nQuads;
+			quads.clear();
+			quadReversed.clear();
+			for (size_t q = i; q < i + nQuads; ++ q) {
+				if (const VecType *p = input.points<FloatType>(q))
+					quads.insert(quads.end(), p, p + 4);
+				else
+					input.copyPolygon<FloatType>(q, std::back_inserter(quads));
+				quadReversed.push_back(NormalizeOrientation<KERNEL>(quads.end() - 4, quads.end()));
+			}
+			quadTriangles.resize(6 * nQuads);
+			TriangulateQuadBatch<KERNEL>(quads.data(), nQuads, quadTriangles.data());
+			for (size_t q = 0; q < nQuads; ++ q) {
+				uint32_t *t = &quadTriangles[6 * q];
+				// A quad with no diagonal inside is left degenerate.
+				if (t[0] == t[1]) {
+					++ nFailed;
+					continue;
+				}
+				const uint32_t offset = uint32_t(input.firstPoint(i + q));
+				for (int k = 0; k < 6; ++ k) {
+					const uint32_t corner = t[k] - uint32_t(4 * q);
+					t[k] = offset + (quadReversed[q] ? (4 - corner) % 4 : corner);
+				}
+				out.write(t, 6 * sizeof(uint32_t));
+				nTriangles += 2;
+			}
+			i += nQuads - 1;
+			continue;
+		}
+
+		const VecType *first = input.points<FloatType>(i);
+		if (first == nullptr) {
+			converted.clear();
+			input.copyPolygon<FloatType>(i, std::back_inserter(converted));
+			first = converted.data();
+		}
+		if (! triangulator->triangulate(first, first + input.polygonSize(i), delaunay)) {
+			++ nFailed;
+			continue;
+		}
+		const MeshType &mesh = triangulator->mesh();
+		const uint32_t offset = uint32_t(input.firstPoint(i));
+		for (size_t f = 0; f < mesh.n_faces(); ++ f) {
+			uint32_t v[3];
+			faceVertexIndices(mesh, mesh.face_handle((unsigned int)f), v, 3);
+			for (uint32_t &k : v)
+				k = offset + uint32_t(triangulator->inputIndex(typename MeshType::VertexHandle(int(k))));
+			out.write(v, sizeof(v));
+		}
+		nTriangles += (long long)mesh.n_faces();
+	}
+	result->nFailed = nFailed;
+	if (nFailed > 0)
+		std::cerr << nFailed << " of " << input.size() << " polygons of " << inputFileName << " could not be triangulated" << std::endl;
+	if (! out.close()) {
+		std::cerr << "Cannot write " << outputFileName << std::endl;
+		return -1;
+	}
+	return nTriangles;
+}
+
+// Files TriangulateBatch() takes from a directory, see loadPoints() and TriangulateMultiPolygonFile().
+inline bool isPolygonFile(const std::filesystem::path &path)
+{
+	const std::string name = path.filename().string();
+	return hasExtension(name, ".txt") || hasExtension(name, ".bpoly") || hasExtension(name, ".qpoly") || hasExtension(name, ".mpoly");
+}
+
+// Outcome of one input of TriangulateBatch().
+struct BatchFileResult
+{
+	std::string	input;					// as given, or the file found in a given directory
+	std::string	output;					// empty if the input was not read, no file is written to it with MESH_FORMAT_NONE
+	const char	*status		= "ok";
+	uintmax_t	bytes		= 0;		// size of the input file
+	size_t		nPoints		= 0;
+	size_t		nTriangles	= 0;
+	double		loadSeconds			= 0;
+	double		triangulateSeconds	= 0;	// ear cutting
+	double		legalizeSeconds		= 0;	// flipping
+	double		writeSeconds		= 0;
+};
+
+/** Replace the directories among the inputs by the polygon files in them, in the order of their names.
+ *  A text file may be given without its extension as for loadPoints(), the extension is added then.
+ *  @return false if there is no file at all
+ */
+inline bool ExpandBatchInputs(const std::vector<std::string> &inputs, std::vector<std::string> &files)
+{
+	namespace fs = std::filesystem;
+
+	files.clear();
+	for (const std::string &input : inputs) {
+		std::error_code ec;
+		if (! fs::is_directory(input, ec)) {
+			files.push_back((! fs::exists(input, ec) && fs::exists(input + ".txt", ec)) ? input + ".txt" : input);
+			continue;
+		}
+		std::vector<std::string> found;
+		for (fs::directory_iterator it(input, ec), end; ! ec && it != end; it.increment(ec))
+			if (it->is_regular_file(ec) && isPolygonFile(it->path()))
+				found.push_back(it->path().string());
+		if (ec)
+			std::cerr << "Cannot list " << input << ": " << ec.message() << std::endl;
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+	if (files.empty()) {
+		std::cerr << "No polygon files to triangulate" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/** Expand the inputs of a batch to the files to triangulate, see TriangulateBatch().
+ *  A file which cannot be read or whose output name is taken already gets its status set and no output.
+ *  The output of dir/name.ext is outputDir/name-CDT, or -CT without delaunay, with the extension of the format,
+ *  or .tri for a .mpoly file, see TriangulateMultiPolygonFile().
+ *  @return false if there is no file at all
+ */
+inline bool CollectBatchFiles(const std::vector<std::string> &inputs, const std::string &outputDir, const bool delaunay,
+	const MeshFormat format, std::vector<BatchFileResult> &files)
+{
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> names;
+	if (! ExpandBatchInputs(inputs, names))
+		return false;
+	files.assign(names.size(), BatchFileResult());
+	for (size_t i = 0; i < names.size(); ++ i)
+		files[i].input = names[i];
+
+	std::set<std::string> outputs;
+	for (BatchFileResult &file : files) {
+		std::error_code ec;
+		file.bytes = fs::file_size(file.input, ec);
+		if (ec) {
+			file.status = "cannot read";
+			continue;
+		}
+		const std::string suffix = std::string(delaunay ? "-CDT" : "-CT") +
+			(hasExtension(file.input, ".mpoly") ? ".tri" : meshFormatExtension(format));
+		const std::string output = (fs::path(outputDir) / (fs::path(file.input).stem().string() + suffix)).string();
+		if (! outputs.insert(output).second)
+			file.status = "output name taken";
+		else
+			file.output = output;
+	}
+	return true;
+}
+
+// Read the input of a batch file, a text file is named without its extension for loadPoints().
+template<typename KERNEL>
+int64_t LoadBatchFile(const BatchFileResult &file, PolygonPoints<KERNEL> &points)
+{
+	const std::string &input = file.input;
+	return points.load(hasExtension(input, ".txt") ? input.substr(0, input.size() - 4) : input);
+}
+
+/** Triangulate a .mpoly file of a batch with all its stages at once, and write it unless the format is MESH_FORMAT_NONE.
+ *  Its time is all counted as triangulateSeconds. A ring which cannot be triangulated fails the file as "not simple".
+ */
+template<typename KERNEL>
+void TriangulateBatchContainer(BatchFileResult &file, PolygonTriangulator<KERNEL> &triangulator, const bool delaunay, const MeshFormat format)
+{
+	const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	MultiPolygonResult result;
+	const long long nTriangles = TriangulateMultiPolygonFile<KERNEL>(file.input,
+		(format == MESH_FORMAT_NONE) ? std::string() : file.output, delaunay, &triangulator, &result);
+	file.triangulateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	file.nPoints = result.nPoints;
+	if (nTriangles < 0)
+		file.status = result.opened ? "cannot write" : "cannot read";
+	else {
+		file.nTriangles = size_t(nTriangles);
+		if (result.nFailed > 0)
+			file.status = "not simple";
+	}
+}
+
+// Print the status and timings of each file of a batch in their order. Returns the number of files which failed.
+inline int ReportBatch(const std::vector<BatchFileResult> &files, const double seconds, const std::string &how)
+{
+	int nFailed = 0;
+	for (const BatchFileResult &file : files) {
+		std::cout << file.input << ": " << file.status << ", " << file.nPoints << " points, " << file.nTriangles << " triangles, "
+			<< std::fixed << std::setprecision(3) << "load " << file.loadSeconds << " s, triangulate " << file.triangulateSeconds
+			<< " s, legalize " << file.legalizeSeconds << " s, write " << file.writeSeconds << " s" << std::defaultfloat << std::endl;
+		if (strcmp(file.status, "ok") != 0)
+			++ nFailed;
+	}
+	std::cout << files.size() - nFailed << " of " << files.size() << " files triangulated in " << std::fixed << std::setprecision(3)
+		<< seconds << " s " << how << std::defaultfloat << std::endl;
+	return nFailed;
+}
+
+template<typename KERNEL>
+void SetBatchRounding()
+{
+	if (sizeof(typename KERNEL::FloatType) == 4)
+		ExactPredicates::setFPURoundingTo24Bits();
+	else
+		ExactPredicates::setFPURoundingTo53Bits();
+}
+
+/** Triangulate many polygon files concurrently, each by one thread, see PolygonTriangulator.
+ *  An input is a polygon file as loadPoints() reads it, given with its extension (.txt, .bpoly or .qpoly),
+ *  a .mpoly file of many rings, see TriangulateBatchContainer(), or a directory, whose polygon files are taken
+ *  in the order of their names. The triangulation of dir/name.ext is written to outputDir/name-CDT.ply, or -CT without delaunay,
+ *  with the extension of the format, that of a .mpoly file to outputDir/name-CDT.tri. An input whose output name is taken by an input before it in this order fails. The largest files are started first, so that a large one
+ *  started last does not keep all the other threads waiting, the smaller ones fill the gaps in between.
+ *  Once all are done, a line with the status and timings of each input is printed in the order of the inputs.
+ *  @param[out]  results - If given, receives the outcome of each input in the same order
+ *  @return number of inputs which failed, or -1 if none was found
+ */
+template<typename KERNEL>
+int TriangulateBatch(const std::vector<std::string> &inputs, const std::string &outputDir, ThreadPool &pool,
+	const bool delaunay = true, const MeshFormat format = MESH_FORMAT_PLY, std::vector<BatchFileResult> *results = nullptr)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto seconds = [](const Clock::time_point from, const Clock::time_point to) { return std::chrono::duration<double>(to - from).count(); };
+	const Clock::time_point start = Clock::now();
+
+	std::vector<BatchFileResult> files;
+	if (! CollectBatchFiles(inputs, outputDir, delaunay, format, files))
+		return -1;
+	// The file size stands in for the number of points, the formats differ by a small factor only.
+	std::vector<size_t> order;
+	for (size_t i = 0; i < files.size(); ++ i)
+		if (! files[i].output.empty())
+			order.push_back(i);
+	std::stable_sort(order.begin(), order.end(), [&files](const size_t a, const size_t b) { return files[a].bytes > files[b].bytes; });
+
+	std::vector<PolygonTriangulator<KERNEL>> triangulators(pool.size());
+	pool.parallelForDynamic(0, order.size(), [&](const size_t k, const unsigned thread) {
+		BatchFileResult &file = files[order[k]];
+		SetBatchRounding<KERNEL>();
+		PolygonTriangulator<KERNEL> &triangulator = triangulators[thread];
+		if (hasExtension(file.input, ".mpoly")) {
+			TriangulateBatchContainer<KERNEL>(file, triangulator, delaunay, format);
+			return;
+		}
+
+		const Clock::time_point t0 = Clock::now();
+		PolygonPoints<KERNEL> points;
+		const int64_t nPoints = LoadBatchFile<KERNEL>(file, points);
+		const Clock::time_point t1 = Clock::now();
+		file.loadSeconds = seconds(t0, t1);
+		if (nPoints < 0) {
+			file.status = "cannot read";
+			return;
+		}
+		file.nPoints = points.size();
+
+		const bool complete = triangulator.triangulate(points.begin(), points.end(), false);
+		const Clock::time_point t2 = Clock::now();
+		file.triangulateSeconds = seconds(t1, t2);
+		file.nTriangles = triangulator.mesh().n_faces();
+		if (! complete) {
+			file.status = "not simple";
+			return;
+		}
+		if (delaunay)
+			triangulator.legalize();
+		const Clock::time_point t3 = Clock::now();
+		file.legalizeSeconds = seconds(t2, t3);
+
+		if (writeMesh(file.output, triangulator.mesh(), format) != 0)
+			file.status = "cannot write";
+		file.writeSeconds = seconds(t3, Clock::now());
+	});
+
+	const int nFailed = ReportBatch(files, seconds(start, Clock::now()), "on " + std::to_string(pool.size()) + " threads");
+	if (results)
+		results->swap(files);
+	return nFailed;
+}
+
+/** Triangulate many polygon files one after another in a pipeline of four threads: reading, ear cutting,
+ *  flipping to Delaunay and writing, see TriangulateBatch() for the inputs, outputs and the report.
+ *  While polygon k is computed, polygon k + 1 is read and the result of polygon k - 1 is written, so the
+ *  computation does not wait for the disk. The files go through the pipeline in the order of the inputs.
+ *  A .mpoly file is read, triangulated and written by the ear cutting stage alone, see TriangulateBatchContainer().
+ *  At most nInFlight polygons are in the pipeline at a time, their meshes and buffers are reused.
+ *  @param[in]  pool - If given, the ear cutting of large polygons runs on it, see EarClippingPool()
+ *  @param[out]  results - If given, receives the outcome of each input in the same order
+ *  @return number of inputs which failed, or -1 if none was found
+ */
+template<typename KERNEL>
+int TriangulateBatchPipelined(const std::vector<std::string> &inputs, const std::string &outputDir, ThreadPool *pool = nullptr,
+	const bool delaunay = true, const MeshFormat format = MESH_FORMAT_PLY, const size_t nInFlight = 4,
+	std::vector<BatchFileResult> *results = nullptr)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto seconds = [](const Clock::time_point from, const Clock::time_point to) { return std::chrono::duration<double>(to - from).count(); };
+	const Clock::time_point start = Clock::now();
+
+	std::vector<BatchFileResult> files;
+	if (! CollectBatchFiles(inputs, outputDir, delaunay, format, files))
+		return -1;
+
+	// A polygon on its way through the pipeline.
+	struct Item {
+		BatchFileResult				*file = nullptr;
+		PolygonPoints<KERNEL>		points;
+		PolygonTriangulator<KERNEL>	triangulator;
+		bool						complete = false;
+		bool						container = false;	// a .mpoly file, done by the cutter at once
+	};
+	typedef std::unique_ptr<Item> ItemPtr;
+
+	// The items go round from idle through read, cut and legalized back to idle. A stage waits on an empty queue
+	// before it, and the reader on idle once nItems polygons are ahead of the writer.
+	const size_t nItems = std::max<size_t>(nInFlight, 1);
+	BoundedQueue<ItemPtr> idle(nItems), read(nItems), cut(nItems), legalized(nItems);
+	for (size_t i = 0; i < nItems; ++ i)
+		idle.push(ItemPtr(new Item));
+
+	std::thread reader([&]() {
+		ItemPtr item;
+		for (BatchFileResult &file : files) {
+			if (file.output.empty() || ! idle.pop(item))
+				continue;
+			item->file = &file;
+			item->container = hasExtension(file.input, ".mpoly");
+			if (item->container) {
+				read.push(std::move(item));
+				continue;
+			}
+			SetBatchRounding<KERNEL>();
+			const Clock::time_point t0 = Clock::now();
+			const int64_t nPoints = LoadBatchFile<KERNEL>(file, item->points);
+			file.loadSeconds = seconds(t0, Clock::now());
+			if (nPoints < 0) {
+				file.status = "cannot read";
+				idle.push(std::move(item));
+			} else {
+				file.nPoints = item->points.size();
+				read.push(std::move(item));
+			}
+		}
+		read.close();
+	});
+	std::thread cutter([&]() {
+		SetBatchRounding<KERNEL>();
+		for (ItemPtr item; read.pop(item); ) {
+			if (item->container) {
+				TriangulateBatchContainer<KERNEL>(*item->file, item->triangulator, delaunay, format);
+				cut.push(std::move(item));
+				continue;
+			}
+			const Clock::time_point t0 = Clock::now();
+			item->complete = item->triangulator.triangulate(item->points.begin(), item->points.end(), false,
+				EarClippingPool(pool, item->points.size()));
+			item->file->triangulateSeconds = seconds(t0, Clock::now());
+			cut.push(std::move(item));
+		}
+		cut.close();
+	});
+	std::thread legalizer([&]() {
+		SetBatchRounding<KERNEL>();
+		for (ItemPtr item; cut.pop(item); ) {
+			const Clock::time_point t0 = Clock::now();
+			if (item->complete && delaunay && ! item->container)
+				item->triangulator.legalize();
+			item->file->legalizeSeconds = seconds(t0, Clock::now());
+			legalized.push(std::move(item));
+		}
+		legalized.close();
+	});
+
+	// Writing on this thread.
+	for (ItemPtr item; legalized.pop(item); ) {
+		BatchFileResult &file = *item->file;
+		if (item->container) {
+			idle.push(std::move(item));
+			continue;
+		}
+		file.nTriangles = item->triangulator.mesh().n_faces();
+		const Clock::time_point t0 = Clock::now();
+		if (! item->complete)
+			file.status = "not simple";
+		else if (writeMesh(file.output, item->triangulator.mesh(), format) != 0)
+			file.status = "cannot write";
+		file.writeSeconds = seconds(t0, Clock::now());
+		idle.push(std::move(item));
+	}
+	reader.join();
+	cutter.join();
+	legalizer.join();
+
+	const int nFailed = ReportBatch(files, seconds(start, Clock::now()), "in a pipeline of " + std::to_string(nItems) + " polygons");
+	if (results)
+		results->swap(files);
+	return nFailed;
+}
+
+/** Order the triangles of a triangulated polygon so that each one is an ear of what remains, by peeling the leaves of the dual tree.
+ *  The vertices of the mesh have to be added in the order of the polygon ring.
+ *  @param[out]  ears - Triangles (prev, tip, next) given by vertex indices, see InsertEarDiagonals()
+ */
+template<typename MeshType, typename Triangle>
+void PeelEars(const MeshType &mesh, std::vector<Triangle> &ears)
+{
+	typedef typename MeshType::HalfedgeHandle HH;
+
+	ears.clear();
+	const size_t nFaces = mesh.n_faces();
+	if (nFaces < 2)
+		return;
+
+	// Edges on the boundary of what remains, and the number of such edges per face. A face with two of them is an ear.
+	std::vector<char>	open(mesh.n_edges(), 0);
+	std::vector<int>	nOpen(nFaces, 0);
+	std::vector<int>	stack;
+	for (auto it = mesh.halfedges_begin(); it != mesh.halfedges_end(); ++ it)
+		if (mesh.is_boundary(*it)) {
+			open[mesh.edge_handle(*it).idx()] = 1;
+			const int f = mesh.face_handle(mesh.opposite_halfedge_handle(*it)).idx();
+			if (++ nOpen[f] == 2)
+				stack.push_back(f);
+		}
+
+	while (! stack.empty() && ears.size() + 1 < nFaces) {
+		const int f = stack.back();
+		stack.pop_back();
+		// Find the diagonal, the only edge of the face still closed.
+		HH hh = mesh.halfedge_handle(mesh.face_handle(f));
+		while (open[mesh.edge_handle(hh).idx()])
+			hh = mesh.next_halfedge_handle(hh);
+		const HH hhNext = mesh.next_halfedge_handle(hh);
+		ears.push_back(Triangle{ mesh.to_vertex_handle(hh).idx(), mesh.to_vertex_handle(hhNext).idx(), mesh.from_vertex_handle(hh).idx() });
+
+		open[mesh.edge_handle(hh).idx()] = 1;
+		const int g = mesh.face_handle(mesh.opposite_halfedge_handle(hh)).idx();
+		if (++ nOpen[g] == 2)
+			stack.push_back(g);
+	}
+}
+
+/** Is the segment (piece[i], piece[j]) a diagonal of the sub-polygon, i.e. inside it and crossing no edge?
+ *  O'Rourke's test: the segment has to lie in the cones of the polygon at both of its end points.
+ */
+template<typename KERNEL, typename VecType>
+bool IsDiagonal(const VecType *points, const std::vector<int> &piece, const int i, const int j)
+{
+	typename KERNEL::Orient orient;
+	const int m = int(piece.size());
+	auto P = [points, &piece, m](int k) -> const VecType& { return points[piece[(k + m) % m]]; };
+
+	auto inCone = [&orient, &P](int k, const VecType &b) {
+		const VecType &a = P(k), &a0 = P(k - 1), &a1 = P(k + 1);
+		if (orient(a, a1, a0) != RIGHT_TURN)
+			return orient(a, b, a0) == LEFT_TURN && orient(b, a, a1) == LEFT_TURN;
+		return ! (orient(a, b, a1) != RIGHT_TURN && orient(b, a, a0) != RIGHT_TURN);
+	};
+	const VecType &a = P(i), &b = P(j);
+	if (! inCone(i, b) || ! inCone(j, a))
+		return false;
+
+	// Collinear c lies on the segment (p, q).
+	auto between = [](const VecType &p, const VecType &q, const VecType &c) {
+		return (p[0] != q[0]) ? ((p[0] <= c[0] && c[0] <= q[0]) || (p[0] >= c[0] && c[0] >= q[0]))
+		                      : ((p[1] <= c[1] && c[1] <= q[1]) || (p[1] >= c[1] && c[1] >= q[1]));
+	};
+	const auto xMin = std::min(a[0], b[0]), xMax = std::max(a[0], b[0]);
+	const auto yMin = std::min(a[1], b[1]), yMax = std::max(a[1], b[1]);
+	for (int k = 0; k < m; ++ k) {
+		const int k1 = (k + 1) % m;
+		if (k == i || k == j || k1 == i || k1 == j)
+			continue;
+		const VecType &c = P(k), &d = P(k1);
+		if (std::max(c[0], d[0]) < xMin || std::min(c[0], d[0]) > xMax || std::max(c[1], d[1]) < yMin || std::min(c[1], d[1]) > yMax)
+			continue;
+		const OrientationType abc = orient(a, b, c), abd = orient(a, b, d);
+		const OrientationType cda = orient(c, d, a), cdb = orient(c, d, b);
+		if (abc * abd < 0 && cda * cdb < 0)
+			return false;
+		if ((abc == STRAIGHT && between(a, b, c)) || (abd == STRAIGHT && between(a, b, d)) ||
+		    (cda == STRAIGHT && between(c, d, a)) || (cdb == STRAIGHT && between(c, d, b)))
+			return false;
+	}
+	return true;
+}
+
+/** Find a diagonal cutting the sub-polygon into two pieces of similar size.
+ *  The candidates are the vertices closest to the median of the longer extent of the bounding box (a kd split),
+ *  pairs of them are tried in the order of how well they balance the two pieces.
+ *  @param[out]  i, j - Positions in piece of the diagonal end points, i < j
+ */
+template<typename KERNEL, typename VecType>
+bool FindSplitDiagonal(const VecType *points, const std::vector<int> &piece, int &i, int &j)
+{
+	const int m = int(piece.size());
+	if (m < 4)
+		return false;
+
+	typename KERNEL::FloatType xMin, xMax, yMin, yMax;
+	xMin = xMax = points[piece[0]][0];
+	yMin = yMax = points[piece[0]][1];
+	for (int p : piece) {
+		xMin = std::min(xMin, points[p][0]);
+		xMax = std::max(xMax, points[p][0]);
+		yMin = std::min(yMin, points[p][1]);
+		yMax = std::max(yMax, points[p][1]);
+	}
+	const int longer = (xMax - xMin >= yMax - yMin) ? 0 : 1;
+
+	// Cut across the longer extent first, across the other one if no diagonal is found.
+	std::vector<int> order(m);
+	std::vector<std::pair<int, std::pair<int, int>>> pairs;
+	for (int axis : { longer, 1 - longer }) {
+		for (int k = 0; k < m; ++ k)
+			order[k] = k;
+		auto coord = [points, &piece, axis](int k) { return points[piece[k]][axis]; };
+		std::nth_element(order.begin(), order.begin() + m / 2, order.end(), [&coord](int k1, int k2) { return coord(k1) < coord(k2); });
+		const auto median = coord(order[m / 2]);
+
+		const int nCandidates = std::min(m, 48);
+		auto distance = [&coord, median](int k) { return std::abs(coord(k) - median); };
+		std::partial_sort(order.begin(), order.begin() + nCandidates, order.end(),
+			[&distance](int k1, int k2) { return distance(k1) < distance(k2) || (distance(k1) == distance(k2) && k1 < k2); });
+
+		// Pairs scored by the size of the smaller piece.
+		pairs.clear();
+		for (int c1 = 0; c1 < nCandidates; ++ c1)
+			for (int c2 = c1 + 1; c2 < nCandidates; ++ c2) {
+				const int k1 = std::min(order[c1], order[c2]);
+				const int k2 = std::max(order[c1], order[c2]);
+				const int balance = std::min(k2 - k1, m - (k2 - k1));
+				if (balance >= 2)
+					pairs.push_back(std::make_pair(- balance, std::make_pair(k1, k2)));
+			}
+		std::sort(pairs.begin(), pairs.end());
+
+		// Each test is linear in the size of the piece, so only the best few pairs are tried.
+		const size_t nTries = std::min<size_t>(pairs.size(), 64);
+		for (size_t k = 0; k < nTries; ++ k)
+			if (IsDiagonal<KERNEL>(points, piece, pairs[k].second.first, pairs[k].second.second)) {
+				i = pairs[k].second.first;
+				j = pairs[k].second.second;
+				return true;
+			}
+	}
+	return false;
+}
+
+/** Constrained Delaunay triangulation of a huge polygon on all threads of the pool.
+ *  The face is cut by diagonals into up to pool.size() pieces, each piece is ear cut and made Delaunay
+ *  in its own mesh on its own thread, the pieces are then stitched into the face, and only the seams
+ *  are legalized again.
+ *  @param[in,out]  mesh          - Mesh containing the face, a simple counterclockwise polygon
+ *  @param[in]      fh            - The face to be triangulated
+ *  @param[in]      minPieceSize  - Pieces are not cut below this number of vertices
+ *  @return false if some piece could not be triangulated completely, the seams are not legalized then
+ */
+template<typename KERNEL>
+bool TriangulateFaceByDomainDecomposition(typename KERNEL::MeshType &mesh, typename KERNEL::MeshType::FaceHandle fh,
+                                          ThreadPool &pool, const size_t minPieceSize = 4096)
+{
+	typedef VectorT<typename KERNEL::FloatType, 2> VecType;
+	typedef typename KERNEL::MeshType				MeshType;
+	typedef typename MeshType::HalfedgeHandle		HH;
+	typedef typename EarClipper<KERNEL>::Triangle	Triangle;
+
+	// A sub-polygon given by positions in the ring of the face, and the halfedges leading from each vertex to the next one.
+	struct Piece {
+		std::vector<int> ring;
+		std::vector<HH>  outgoing;
+	};
+
+	std::vector<Piece> pieces(1);
+	std::vector<VecType> ring;
+	CollectFaceBoundary(mesh, fh, pieces.front().outgoing, ring);
+	const int n = int(ring.size());
+	pieces.front().ring.resize(n);
+	for (int i = 0; i < n; ++ i)
+		pieces.front().ring[i] = i;
+
+	// Cut the largest piece as long as there are idle threads.
+	std::vector<typename MeshType::EdgeHandle> seams;
+	std::vector<char> splittable(1, 1);
+	while (pieces.size() < pool.size()) {
+		size_t k = pieces.size();
+		for (size_t l = 0; l < pieces.size(); ++ l)
+			if (splittable[l] && pieces[l].ring.size() >= 2 * minPieceSize && (k == pieces.size() || pieces[l].ring.size() > pieces[k].ring.size()))
+				k = l;
+		if (k == pieces.size())
+			break;
+		int i, j;
+		if (! FindSplitDiagonal<KERNEL>(ring.data(), pieces[k].ring, i, j)) {
+			splittable[k] = 0;
+			continue;
+		}
+
+		// hhSeam leads from i to j and closes the piece j..i, its opposite closes the piece i..j.
+		Piece &piece = pieces[k];
+		const int m = int(piece.ring.size());
+		const HH hhSeam = mesh.insert_edge(piece.outgoing[(i + m - 1) % m], piece.outgoing[j]);
+		seams.push_back(mesh.edge_handle(hhSeam));
+
+		Piece second;
+		second.ring.assign(piece.ring.begin() + j, piece.ring.end());
+		second.ring.insert(second.ring.end(), piece.ring.begin(), piece.ring.begin() + i + 1);
+		second.outgoing.assign(piece.outgoing.begin() + j, piece.outgoing.end());
+		second.outgoing.insert(second.outgoing.end(), piece.outgoing.begin(), piece.outgoing.begin() + i);
+		second.outgoing.push_back(hhSeam);
+
+		piece.ring.erase(piece.ring.begin() + j + 1, piece.ring.end());
+		piece.ring.erase(piece.ring.begin(), piece.ring.begin() + i);
+		piece.outgoing.erase(piece.outgoing.begin() + j, piece.outgoing.end());
+		piece.outgoing.erase(piece.outgoing.begin(), piece.outgoing.begin() + i);
+		piece.outgoing.push_back(mesh.opposite_halfedge_handle(hhSeam));
+
+		pieces.push_back(std::move(second));
+		splittable.push_back(1);
+	}
+
+	// Ear cut and legalize each piece in a mesh of its own, then turn its triangulation into a cutting order.
+	std::vector<std::vector<Triangle>> ears(pieces.size());
+	std::vector<char> complete(pieces.size(), 0);
+	pool.parallelFor(0, pieces.size(), [&](size_t k) {
+		MeshType pieceMesh;
+		std::vector<typename MeshType::VertexHandle> vertices;
+		vertices.reserve(pieces[k].ring.size());
+		for (int p : pieces[k].ring)
+			vertices.push_back(pieceMesh.add_vertex(ring[p]));
+		typename MeshType::FaceHandle pieceFh = pieceMesh.add_face(vertices);
+		if (TriangulateFaceByEarCutting<KERNEL>(pieceMesh, pieceFh)) {
+			MakeDelaunayByDiagonalFlipping<KERNEL>(pieceMesh);
+			PeelEars(pieceMesh, ears[k]);
+			complete[k] = 1;
+		}
+	});
+
+	// Stitch the pieces into the face and legalize the seams, the flips propagate into the pieces as needed.
+	// A piece which got stuck stays a single face, which is no triangle, so nothing is flipped then.
+	for (size_t k = 0; k < pieces.size(); ++ k)
+		InsertEarDiagonals(mesh, pieces[k].outgoing, ears[k]);
+	if (std::find(complete.begin(), complete.end(), 0) != complete.end())
+		return false;
+	std::vector<char> queued;
+	LegalizeEdges<KERNEL>(mesh, seams, queued);
+	return true;
+}
+
+/** Out-of-core ear clipping of a polygon read from a file, for polygons which do not fit in memory.
+ *  The ring is read three times from the mapped file, a text file in blocks of whole lines by parsePoints(),
+ *  a .bpoly file point by point. The first pass finds the bounding box and the orientation, the second one records for
+ *  each cell of a grid over the bounding box the last vertex falling into it. The third pass appends the vertices to
+ *  a chain and clips the ears of the chain as soon as it is known that no vertex of the polygon lies in them:
+ *  the vertices still in the chain are bucketed in the grid, and a cell whose last vertex has been read cannot get any more.
+ *  Ears waiting for a cell are retried once its last vertex has been read. The triangles are written to the output
+ *  as soon as they are clipped, what remains of the chain at the end is clipped by EarClipper.
+ *  Peak memory is given by the budget, not by the input size. The budget bounds the number of vertices kept in the chain,
+ *  the triangulation fails if more are needed, e.g. for a spiral whose ears complete only at the end of the file.
+ *  The pages of the mapped input are not counted, the OS may drop them at any time as they are never written.
+ *  The output is a sequence of little endian uint32 triples of input vertex indices, counterclockwise.
+ */
+template<typename KERNEL>
+class StreamingEarClipper
+{
+public:
+	typedef VectorT<typename KERNEL::FloatType, 2>			VecType;
+	typedef PolygonEar<VecType, typename KERNEL::Orient>	Ear;
+
+	explicit StreamingEarClipper(const size_t memoryBudget = size_t(256) << 20) : budget(memoryBudget), out(outBufferBytes) {}
+
+	/** Triangulate the polygon in inputFileName + ".txt", or in inputFileName itself if it ends by .bpoly, see loadPoints().
+	 *  A point of a text file must not span two lines.
+	 *  @return number of triangles written to outputFileName + ".tri", -1 on error
+	 */
+	long long triangulate(const std::string &inputFileName, const std::string &outputFileName)
+	{
+		binary = hasExtension(inputFileName, ".bpoly");
+		inputPath = binary ? inputFileName : inputFileName + ".txt";
+		if (! scan())
+			return -1;
+		if (nPoints < 3 || nPoints > size_t(std::numeric_limits<uint32_t>::max())) {
+			std::cerr << "Cannot triangulate " << inputFileName << " with " << nPoints << " vertices" << std::endl;
+			return -1;
+		}
+		if (! setup(inputFileName))
+			return -1;
+
+		if (! out.open(outputFileName + ".tri")) {
+			std::cerr << "Cannot open " << outputFileName + ".tri" << std::endl;
+			return -1;
+		}
+		nTriangles = 0;
+
+		// Third pass, clip while reading.
+		bool overflow = false;
+		const bool read = forEachPoint([this, &overflow](VecType p) {
+			if (overflow)
+				return;
+			if (! append(p)) {
+				overflow = true;
+				return;
+			}
+			while (! waiting.empty() && waiting.top().readyAt < nRead) {
+				const Waiting w = waiting.top();
+				waiting.pop();
+				if (nodes[w.slot].version == w.version)
+					clipFrom(w.slot);
+			}
+		});
+		if (overflow)
+			std::cerr << "Streaming triangulation of " << inputFileName << " needs more than " << budget << " bytes" << std::endl;
+		if (! read || overflow)
+			return -1;
+
+		// All cells are complete now, clip what remains in memory.
+		const bool complete = clipResidual();
+		if (! out.close()) {
+			std::cerr << "Cannot write " << outputFileName + ".tri" << std::endl;
+			return -1;
+		}
+		if (! complete) {
+			std::cerr << "Ear cutting of " << inputFileName << " got stuck, the polygon is not simple" << std::endl;
+			return -1;
+		}
+		return (long long)nTriangles;
+	}
+
+	// Vertices kept in memory at most, known after triangulate().
+	size_t capacity() const { return nCapacity; }
+
+private:
+	// Vertex of the chain, linked to its neighbours in the chain and to the other vertices of its grid cell.
+	struct Node {
+		VecType		p;
+		uint32_t	index;
+		int			prev, next;
+		int			cellPrev, cellNext;
+		uint32_t	version;	// changes with the neighbours, makes queued retries stale
+		char		reflex;		// collinear and the chain ends count as reflex
+	};
+	// Tip to be retried after vertex readyAt has been read.
+	struct Waiting {
+		uint32_t	readyAt;
+		int			slot;
+		uint32_t	version;
+		bool operator<(const Waiting &w) const { return readyAt > w.readyAt; }
+	};
+	// Memory of the final EarClipper per vertex of the remaining chain.
+	static const size_t residualBytesPerVertex = 64;
+	static const size_t outBufferBytes = size_t(3) << 16;
+	// Text parsed at a time, a point takes at least 4 characters of it.
+	static const size_t blockBytes = size_t(1) << 16;
+	static const size_t blockPoints = blockBytes / 4;
+
+	// Calls fn for each point of the input in order. Syntax errors are reported with their line numbers.
+	template<typename Fn>
+	bool forEachPoint(Fn fn)
+	{
+		if (binary) {
+			BinaryPolygonFile polygon;
+			if (! polygon.open(inputPath))
+				return false;
+			for (size_t i = 0; i < polygon.size(); ++ i)
+				fn(polygon.point<typename KERNEL::FloatType>(i));
+			return true;
+		}
+		MappedFile file;
+		if (! file.open(inputPath)) {
+			std::cerr << "Cannot open " << inputPath << std::endl;
+			return false;
+		}
+		size_t line = 1;
+		for (const char *first = file.begin(); first != file.end(); ) {
+			const char *last = std::find(first + std::min(blockBytes, size_t(file.end() - first)), file.end(), '\n');
+			if (last != file.end())
+				++ last;
+			block.clear();
+			size_t blockLine = 0;
+			if (const char *error = parsePoints(first, last, block, blockLine)) {
+				std::cerr << "Error: " << inputPath << ", line " << line + blockLine << ": " << error << std::endl;
+				return false;
+			}
+			for (const VecType &p : block)
+				fn(p);
+			line += blockLine;
+			first = last;
+		}
+		return true;
+	}
+
+	// First pass, bounding box and orientation given by the lowest vertex, see PolygonOrientation().
+	bool scan()
+	{
+		nPoints = 0;
+		VecType first, prev, low, lowPrev, lowNext;
+		ExactSum area;
+		const bool read = forEachPoint([&](const VecType &p) {
+			if (nPoints == 0) {
+				first = low = p;
+				xMin = xMax = double(p[0]);
+				yMin = yMax = double(p[1]);
+			} else {
+				if (nPoints == 1 || lowNext == low)
+					lowNext = p;
+				if (p[1] < low[1] || (p[1] == low[1] && p[0] < low[0])) {
+					low = lowNext = p;
+					lowPrev = prev;
+				}
+				xMin = std::min(xMin, double(p[0]));
+				xMax = std::max(xMax, double(p[0]));
+				yMin = std::min(yMin, double(p[1]));
+				yMax = std::max(yMax, double(p[1]));
+				area.addCross(double(prev[0]), double(p[1]), double(p[0]), double(prev[1]));
+			}
+			prev = p;
+			++ nPoints;
+		});
+		if (! read || nPoints < 3)
+			return read;
+		if (low == first)
+			lowPrev = prev;
+		if (lowNext == low)
+			lowNext = first;
+		area.addCross(double(prev[0]), double(first[1]), double(first[0]), double(prev[1]));
+		OrientationType orientation = typename KERNEL::Orient()(lowPrev, low, lowNext);
+		if (orientation == STRAIGHT)
+			orientation = (area.sign() > 0) ? LEFT_TURN : RIGHT_TURN;
+		mirrored = orientation == RIGHT_TURN;
+		if (mirrored) {
+			std::swap(xMin, xMax);
+			xMin = - xMin;
+			xMax = - xMax;
+		}
+		return true;
+	}
+
+	// Second pass, the grid of last vertices. Splits the budget between the grid and the chain.
+	bool setup(const std::string &inputFileName)
+	{
+		const size_t bytesPerCell = sizeof(uint32_t) + sizeof(int);
+		const size_t gridBudget   = budget / 4;
+		const size_t nCells = std::max<size_t>(1, std::min(nPoints / 2, gridBudget / bytesPerCell));
+		const double width = std::max(xMax - xMin, 1e-300), height = std::max(yMax - yMin, 1e-300);
+		gridNX = int(std::max(1., std::min(double(nCells), std::sqrt(double(nCells) * width / height))));
+		gridNY = int(std::max<size_t>(1, nCells / gridNX));
+		gridScaleX = (xMax > xMin) ? gridNX / (xMax - xMin) : 0.;
+		gridScaleY = (yMax > yMin) ? gridNY / (yMax - yMin) : 0.;
+
+		const size_t fixedBytes   = size_t(gridNX) * gridNY * bytesPerCell + outBufferBytes + (binary ? 0 : blockPoints * sizeof(VecType));
+		const size_t bytesPerNode = sizeof(Node) + 2 * sizeof(Waiting) + residualBytesPerVertex;
+		if (budget < fixedBytes + 16 * bytesPerNode) {
+			std::cerr << "Memory budget of " << budget << " bytes is too small for " << inputFileName << std::endl;
+			return false;
+		}
+		nCapacity = std::min(nPoints, (budget - fixedBytes) / bytesPerNode);
+		nodes.assign(nCapacity, Node());
+
+		lastIndex.assign(size_t(gridNX) * gridNY, 0);
+		cellHead.assign(lastIndex.size(), -1);
+		uint32_t i = 0;
+		if (! forEachPoint([this, &i](VecType p) { lastIndex[cell(orient(p))] = i ++; }))
+			return false;
+
+		for (size_t k = 0; k < nodes.size(); ++ k)
+			nodes[k].next = int(k) + 1;
+		nodes.back().next = -1;
+		freeHead = 0;
+		head = tail = -1;
+		nRead = 0;
+		waiting = std::priority_queue<Waiting>();
+		return true;
+	}
+
+	VecType orient(VecType p) const
+	{
+		if (mirrored)
+			p[0] = - p[0];
+		return p;
+	}
+
+	int cellX(const double x) const { return std::min(gridNX - 1, std::max(0, int((x - xMin) * gridScaleX))); }
+	int cellY(const double y) const { return std::min(gridNY - 1, std::max(0, int((y - yMin) * gridScaleY))); }
+	int cell(const VecType &p) const { return cellY(double(p[1])) * gridNX + cellX(double(p[0])); }
+
+	bool append(const VecType &p)
+	{
+		if (freeHead < 0)
+			return false;
+		const int v = freeHead;
+		Node &node = nodes[v];
+		freeHead = node.next;
+		node.p		 = orient(p);
+		node.index	 = uint32_t(nRead ++);
+		node.prev	 = tail;
+		node.next	 = -1;
+		node.reflex	 = 1;
+		const int c = cell(node.p);
+		node.cellPrev = -1;
+		node.cellNext = cellHead[c];
+		if (cellHead[c] >= 0)
+			nodes[cellHead[c]].cellPrev = v;
+		cellHead[c] = v;
+
+		if (tail < 0)
+			head = v;
+		else
+			nodes[tail].next = v;
+		const int tip = tail;
+		tail = v;
+		if (tip >= 0) {
+			++ nodes[tip].version;
+			updateReflex(tip);
+			clipFrom(tip);
+		}
+		return true;
+	}
+
+	void updateReflex(const int v)
+	{
+		Node &node = nodes[v];
+		node.reflex = node.prev < 0 || node.next < 0 || ! Ear(nodes[node.prev].p, node.p, nodes[node.next].p).isConvex();
+	}
+
+	// Clip the ear at v if there is one, and the ears it uncovers behind and ahead.
+	void clipFrom(int v)
+	{
+		stack.clear();
+		stack.push_back(v);
+		while (! stack.empty()) {
+			v = stack.back();
+			stack.pop_back();
+			uint32_t readyAt = 0;
+			if (! isEar(v, readyAt)) {
+				if (readyAt > 0) {
+					if (waiting.size() >= 2 * nodes.size())
+						dropStale();
+					waiting.push(Waiting{ readyAt, v, nodes[v].version });
+				}
+				continue;
+			}
+			const int prev = nodes[v].prev, next = nodes[v].next;
+			emit(nodes[prev].index, nodes[v].index, nodes[next].index);
+			remove(v);
+			updateReflex(prev);
+			updateReflex(next);
+			stack.push_back(next);
+			stack.push_back(prev);
+		}
+	}
+
+	// Keep the queue within its share of the budget by dropping the retries of vertices which have changed since.
+	void dropStale()
+	{
+		std::vector<Waiting> current;
+		for (; ! waiting.empty(); waiting.pop())
+			if (nodes[waiting.top().slot].version == waiting.top().version)
+				current.push_back(waiting.top());
+		waiting = std::priority_queue<Waiting>(std::less<Waiting>(), std::move(current));
+	}
+
+	// Ear test against the chain. If a vertex may still come into the ear, readyAt is set to the last one that can.
+	bool isEar(const int v, uint32_t &readyAt) const
+	{
+		const Node &node = nodes[v];
+		if (node.reflex)
+			return false;
+		const VecType &a = nodes[node.prev].p, &b = node.p, &c = nodes[node.next].p;
+		Ear candidate(a, b, c);
+		const typename KERNEL::FloatType xLo = std::min(a[0], std::min(b[0], c[0])), xHi = std::max(a[0], std::max(b[0], c[0]));
+		const typename KERNEL::FloatType yLo = std::min(a[1], std::min(b[1], c[1])), yHi = std::max(a[1], std::max(b[1], c[1]));
+		const int cx0 = cellX(double(xLo)), cx1 = cellX(double(xHi));
+		const int cy0 = cellY(double(yLo)), cy1 = cellY(double(yHi));
+		readyAt = 0;
+		for (int cy = cy0; cy <= cy1; ++ cy) {
+			// Only the cells of this row overlapping the triangle, as in EarClipper::isEar().
+			int cxFirst = cx0, cxLast = cx1;
+			if (cy0 < cy1 && cx0 < cx1) {
+				const double margin = 1e-9 * (yMax - yMin);
+				const double y0 = yMin + cy / gridScaleY - margin;
+				const double y1 = yMin + (cy + 1) / gridScaleY + margin;
+				double rowLo = std::numeric_limits<double>::max(), rowHi = - std::numeric_limits<double>::max();
+				ClipSegmentToRow(a, b, y0, y1, rowLo, rowHi);
+				ClipSegmentToRow(b, c, y0, y1, rowLo, rowHi);
+				ClipSegmentToRow(c, a, y0, y1, rowLo, rowHi);
+				if (rowLo > rowHi)
+					continue;
+				const double marginX = 1e-9 * (xMax - xMin);
+				cxFirst = std::max(cx0, cellX(rowLo - marginX));
+				cxLast  = std::min(cx1, cellX(rowHi + marginX));
+			}
+			for (int cx = cxFirst; cx <= cxLast; ++ cx) {
+				const int k = cy * gridNX + cx;
+				if (lastIndex[k] >= nRead)
+					readyAt = std::max(readyAt, lastIndex[k]);
+				for (int r = cellHead[k]; r >= 0; r = nodes[r].cellNext) {
+					const Node &other = nodes[r];
+					if (! other.reflex || r == node.prev || r == node.next)
+						continue;
+					if (other.p[0] < xLo || other.p[0] > xHi || other.p[1] < yLo || other.p[1] > yHi)
+						continue;
+					if (candidate.contains(other.p)) {
+						readyAt = 0;
+						return false;
+					}
+				}
+			}
+		}
+		return readyAt == 0;
+	}
+
+	void remove(const int v)
+	{
+		Node &node = nodes[v];
+		nodes[node.prev].next = node.next;
+		nodes[node.next].prev = node.prev;
+		++ nodes[node.prev].version;
+		++ nodes[node.next].version;
+		const int c = cell(node.p);
+		if (node.cellPrev >= 0)
+			nodes[node.cellPrev].cellNext = node.cellNext;
+		else
+			cellHead[c] = node.cellNext;
+		if (node.cellNext >= 0)
+			nodes[node.cellNext].cellPrev = node.cellPrev;
+		// Copies of v may still be on the stack of clipFrom(), a reflex vertex is never tested.
+		++ node.version;
+		node.reflex = 1;
+		node.next = freeHead;
+		freeHead = v;
+	}
+
+	bool clipResidual()
+	{
+		std::vector<VecType>	ring;
+		std::vector<uint32_t>	index;
+		for (int v = head; v >= 0; v = nodes[v].next) {
+			ring.push_back(nodes[v].p);
+			index.push_back(nodes[v].index);
+		}
+		std::vector<Node>().swap(nodes);
+		std::vector<uint32_t>().swap(lastIndex);
+		std::vector<int>().swap(cellHead);
+		waiting = std::priority_queue<Waiting>();
+		if (ring.size() < 3)
+			return ring.size() == 2;
+
+		EarClipper<KERNEL> clipper;
+		const bool complete = clipper.clip(ring.data(), int(ring.size()));
+		for (const auto &t : clipper.triangles())
+			emit(index[t.prev], index[t.tip], index[t.next]);
+		return complete;
+	}
+
+	// The triangles of a mirrored polygon are mirrored back by swapping two corners.
+	void emit(const uint32_t a, const uint32_t b, const uint32_t c)
+	{
+		const uint32_t triangle[3] = { a, mirrored ? c : b, mirrored ? b : c };
+		out.write(triangle, sizeof(triangle));
+		++ nTriangles;
+	}
+
+	size_t						budget;
+	std::string					inputPath;
+	bool						binary = false;		// .bpoly input, otherwise text
+	std::vector<VecType>		block;				// points of the text parsed at a time
+	size_t						nPoints = 0;
+	bool						mirrored = false;
+	double						xMin = 0., xMax = 0., yMin = 0., yMax = 0.;
+	int							gridNX = 1, gridNY = 1;
+	double						gridScaleX = 0., gridScaleY = 0.;
+	std::vector<uint32_t>		lastIndex;
+	std::vector<int>			cellHead;
+	// Slots of the chain vertices, the free ones linked through next.
+	std::vector<Node>			nodes;
+	size_t						nCapacity = 0;
+	int							freeHead = -1, head = -1, tail = -1;
+	uint32_t					nRead = 0;
+	std::priority_queue<Waiting> waiting;
+	std::vector<int>			stack;
+	BufferedWriter				out;
+	size_t						nTriangles = 0;
+};
+
+// Position of the cell (x, y) of the 2^16 x 2^16 grid along the Hilbert curve filling it.
+inline uint32_t HilbertKey(uint32_t x, uint32_t y)
+{
+	const uint32_t n = 1u << 16;
+	uint32_t key = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		const uint32_t rx = (x & s) ? 1 : 0;
+		const uint32_t ry = (y & s) ? 1 : 0;
+		key += s * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant, so that the curve continues where it left the previous one.
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return key;
+}
+
+/** Renumber the vertices, edges and faces of a mesh for cache locality and store them compactly.
+ *  Vertices and faces (by their centroids) follow a Hilbert curve over the bounding box, edges are numbered in the order
+ *  the faces reach them, so walking the mesh walks memory mostly sequentially. The connectivity including the orientation
+ *  of every halfedge is kept, only the indices change.
+ *  @param[out]  vertexOrder  - If given, the old index of each vertex in the new order.
+ */
+template<typename MeshType>
+void ReorderAlongHilbertCurve(MeshType &mesh, std::vector<int> *vertexOrder = nullptr)
+{
+	typedef typename MeshType::VertexHandle		VH;
+	typedef typename MeshType::HalfedgeHandle	HH;
+	typedef typename MeshType::EdgeHandle		EH;
+	typedef typename MeshType::FaceHandle		FH;
+
+	const int nVertices = int(mesh.n_vertices());
+	const int nEdges	= int(mesh.n_edges());
+	const int nFaces	= int(mesh.n_faces());
+	if (nVertices == 0)
+		return;
+
+	double xMin = std::numeric_limits<double>::max(), xMax = - xMin;
+	double yMin = xMin, yMax = xMax;
+	for (auto it = mesh.vertices_begin(); it != mesh.vertices_end(); ++ it) {
+		const typename MeshType::Point p = mesh.point(*it);
+		xMin = std::min(xMin, double(p[0]));
+		xMax = std::max(xMax, double(p[0]));
+		yMin = std::min(yMin, double(p[1]));
+		yMax = std::max(yMax, double(p[1]));
+	}
+	const double scaleX = (xMax > xMin) ? 65535. / (xMax - xMin) : 0.;
+	const double scaleY = (yMax > yMin) ? 65535. / (yMax - yMin) : 0.;
+	auto key = [=](double x, double y) { return HilbertKey(uint32_t((x - xMin) * scaleX), uint32_t((y - yMin) * scaleY)); };
+
+	// Sort by the keys, ties in the old order.
+	std::vector<std::pair<uint32_t, int>> keys(nVertices);
+	for (int i = 0; i < nVertices; ++ i) {
+		const typename MeshType::Point p = mesh.point(VH(i));
+		keys[i] = std::make_pair(key(double(p[0]), double(p[1])), i);
+	}
+	std::sort(keys.begin(), keys.end());
+	std::vector<int> oldVertex(nVertices), newVertex(nVertices);
+	for (int i = 0; i < nVertices; ++ i) {
+		oldVertex[i] = keys[i].second;
+		newVertex[keys[i].second] = i;
+	}
+
+	keys.resize(nFaces);
+	for (int f = 0; f < nFaces; ++ f) {
+		double x = 0., y = 0.;
+		int n = 0;
+		const HH hhFirst = mesh.halfedge_handle(FH(f));
+		HH hh = hhFirst;
+		do {
+			const typename MeshType::Point p = mesh.point(mesh.to_vertex_handle(hh));
+			x += double(p[0]);
+			y += double(p[1]);
+			++ n;
+			hh = mesh.next_halfedge_handle(hh);
+		} while (hh != hhFirst);
+		keys[f] = std::make_pair(key(x / n, y / n), f);
+	}
+	std::sort(keys.begin(), keys.end());
+	std::vector<int> newFace(nFaces);
+	for (int f = 0; f < nFaces; ++ f)
+		newFace[keys[f].second] = f;
+
+	std::vector<int> edgeOrder, newEdge(nEdges, -1);
+	edgeOrder.reserve(nEdges);
+	for (int f = 0; f < nFaces; ++ f) {
+		const HH hhFirst = mesh.halfedge_handle(FH(keys[f].second));
+		HH hh = hhFirst;
+		do {
+			const int e = mesh.edge_handle(hh).idx();
+			if (newEdge[e] < 0) {
+				newEdge[e] = int(edgeOrder.size());
+				edgeOrder.push_back(e);
+			}
+			hh = mesh.next_halfedge_handle(hh);
+		} while (hh != hhFirst);
+	}
+	for (int e = 0; e < nEdges; ++ e)
+		if (newEdge[e] < 0) {
+			newEdge[e] = int(edgeOrder.size());
+			edgeOrder.push_back(e);
+		}
+
+	// Rebuild. The halfedge i of an edge stays its halfedge i.
+	MeshType reordered;
+	reordered.reserve(nVertices, nEdges, nFaces);
+	for (int i = 0; i < nVertices; ++ i)
+		reordered.add_vertex(mesh.point(VH(oldVertex[i])));
+	for (int e = 0; e < nEdges; ++ e) {
+		const HH hh = mesh.halfedge_handle(EH(edgeOrder[e]), 0);
+		reordered.new_edge(VH(newVertex[mesh.from_vertex_handle(hh).idx()]), VH(newVertex[mesh.to_vertex_handle(hh).idx()]));
+	}
+	for (int f = 0; f < nFaces; ++ f)
+		reordered.new_face();
+
+	auto newHalfedge = [&mesh, &reordered, &newEdge](const HH hh) {
+		const EH eh = mesh.edge_handle(hh);
+		return reordered.halfedge_handle(EH(newEdge[eh.idx()]), hh == mesh.halfedge_handle(eh, 0) ? 0 : 1);
+	};
+	for (auto it = mesh.halfedges_begin(); it != mesh.halfedges_end(); ++ it) {
+		const HH hh = newHalfedge(*it);
+		reordered.set_next_halfedge_handle(hh, newHalfedge(mesh.next_halfedge_handle(*it)));
+		const FH fh = mesh.face_handle(*it);
+		reordered.set_face_handle(hh, fh.is_valid() ? FH(newFace[fh.idx()]) : FH());
+	}
+	for (int i = 0; i < nVertices; ++ i) {
+		const HH hh = mesh.halfedge_handle(VH(oldVertex[i]));
+		if (hh.is_valid())
+			reordered.set_halfedge_handle(VH(i), newHalfedge(hh));
+	}
+	for (int f = 0; f < nFaces; ++ f)
+		reordered.set_halfedge_handle(FH(newFace[f]), newHalfedge(mesh.halfedge_handle(FH(f))));
+
+	mesh = reordered;
+	if (vertexOrder)
+		vertexOrder->swap(oldVertex);
+}
+
+// How testCDT() triangulates the input polygon.
+enum TriangulationEngine {
+	ENGINE_EAR_CUTTING,				// ear cutting of the whole polygon, then flipping to Delaunay
+	ENGINE_DOMAIN_DECOMPOSITION,	// see TriangulateFaceByDomainDecomposition(), needs a pool
+};
+
+// Stages of testCDT() to draw and write an image of.
+enum RenderStage {
+	RENDER_INPUT	= 1,
+	RENDER_CT		= 2,	// after the ear cutting
+	RENDER_CDT		= 4,	// after the flipping
+	RENDER_ALL		= RENDER_INPUT | RENDER_CT | RENDER_CDT,
+};
+
+// What testCDT() does besides the ear cutting.
+struct RunOptions
+{
+	TriangulationEngine	engine		= ENGINE_EAR_CUTTING;
+	bool				delaunay	= true;				// flip to Delaunay after the ear cutting
+	unsigned			render		= RENDER_ALL;		// RenderStage flags, 0 for none
+	bool				reorder		= false;			// renumber along a Hilbert curve before flipping, see ReorderAlongHilbertCurve()
+	bool				printPoints	= false;			// print the input points to cout
+	bool				saveSnapshot = false;			// save the mesh after the ear cutting, see saveMeshSnapshot()
+	MeshFormat			format		= MESH_FORMAT_PLY;	// of the final triangulation
+};
+
+/** Triangulate the polygon in filename, see loadPoints(). With name the file name without its directory and
+ *  without the extension .bpoly or .qpoly, as in CollectBatchFiles(), the triangulation is written to dir/name-CDT.ply,
+ *  or -CT without flipping, with the extension of the format.
+ *  The images of the stages in options.render go to dir/name-input.tga, dir/name-CT.tga and dir/name-CDT.tga.
+ *  Without an image or any stage to render, nothing is drawn, not even the viewport is computed.
+ *  With an imageWriter, the images are written on its thread while the triangulation goes on, and the failures to write
+ *  them are left to its finish(), see RunCommandLine(); without one, they are written here in turn.
+ *  A polygon whose ear cutting gets stuck is neither flipped nor written, only the images up to -CT are.
+ *  With options.saveSnapshot, the mesh after the ear cutting is saved to dir/name-CT.msnap, see FlipSnapshots().
+ *  @return false if the polygon cannot be read, is degenerate or not simple, or the triangulation or snapshot cannot be written
+ */
 template <class KERNEL> 
-void testCDT( std::string dir, std::string filename, Image & image )
+bool testCDT( std::string dir, std::string filename, Image * image, AsyncImageWriter * imageWriter = nullptr, ThreadPool * pool = nullptr,
+              const RunOptions &options = RunOptions() )
 {
   // set the floating point unit 
   // just to have equal conditions on different HW
@@ -614,69 +2871,584 @@ void testCDT( std::string dir, std::string filename, Image & image )
   else
     ExactPredicates::setFPURoundingTo53Bits();
 
-  typedef VectorT<typename KERNEL::FloatType, 2> VecType;
-  std::vector<VecType> points;
-  readPoints<KERNEL>( filename, std::back_inserter(points) );
-  updateImageViewport(points.begin(), points.end(), image);
+  // A .bpoly file of the kernel's float type is used in place, see PolygonPoints.
+  PolygonPoints<KERNEL> points;
+  if (points.load( filename, pool ) < 0)
+    return false;
+  std::string name = std::filesystem::path(filename).filename().string();
+  if (hasExtension(name, ".bpoly") || hasExtension(name, ".qpoly"))
+    name = std::filesystem::path(name).stem().string();
+  const bool render = image != nullptr && (options.render & RENDER_ALL) != 0;
+  if (render)
+    updateImageViewport(points.begin(), points.end(), *image);
 
   std::cout << "Input: "<< filename << std::endl;
-  printPoints( points.begin(), points.end());
+  if (options.printPoints)
+    printPoints( points.begin(), points.end());
+
+  // Fewer than three points make no face, see PolygonTriangulator::triangulate().
+  if (points.size() < 3) {
+    std::cerr << "Polygon " << filename << " is degenerate, it has only " << points.size() << " points" << std::endl;
+    return false;
+  }
 
   // Initialize mesh structure with a single face representing the input simple polygon.
   typename KERNEL::MeshType	mesh;
   typename std::vector<typename KERNEL::MeshType::VertexHandle> vertices;
-  for (auto it = points.begin(); it != points.end(); ++it)
-	  vertices.push_back(mesh.add_vertex(*it));
-  typename KERNEL::MeshType::FaceHandle	fh = mesh.add_face(vertices);
+  bool reversed = false;
+  typename KERNEL::MeshType::FaceHandle	fh = AddPolygonFace<KERNEL>(mesh, points.begin(), points.end(), vertices, &reversed);
+  if (reversed)
+    std::cout << "Clockwise input, reversed to counterclockwise order" << std::endl;
+
+  // Repeated points OpenMesh refuses as a face leave nothing to cut ears from.
+  if (! fh.is_valid()) {
+    std::cerr << "Polygon " << filename << " is degenerate, no face can be made of its " << points.size() << " points" << std::endl;
+    return false;
+  }
+
+  auto renderStage = [&](const RenderStage stage, const std::string &suffix) {
+    if (render && (options.render & stage) != 0) {
+      image->erase();
+      drawMesh(mesh, *image);
+      if (imageWriter)
+        imageWriter->write(*image, dir+"/"+name+suffix+".tga");
+      else
+        image->write(dir+"/"+name+suffix+".tga");
+    }
+  };
+  renderStage(RENDER_INPUT, "-input");
+
+  // The pieces of the domain decomposition are made Delaunay already, so are the seams between them.
+  const bool decompose = options.engine == ENGINE_DOMAIN_DECOMPOSITION && pool != nullptr;
+  const bool complete  = decompose ? TriangulateFaceByDomainDecomposition<KERNEL>(mesh, fh, *pool)
+                                   : TriangulateFaceByEarCutting<KERNEL>(mesh, fh, EarClippingPool(pool, points.size()));
+  if (options.reorder)
+    ReorderAlongHilbertCurve(mesh);
+
+  renderStage(RENDER_CT, "-CT");
+
+  // What is left of the face is no triangle, the flipping expects triangles on both sides of each edge.
+  if (! complete) {
+    std::cerr << "Ear cutting of " << filename << " got stuck, the polygon is not simple" << std::endl;
+    return false;
+  }
+  const bool saved = ! options.saveSnapshot || saveMeshSnapshot(dir+"/"+name+"-CT.msnap", mesh) == 0;
+
+  if (options.delaunay) {
+    if (! decompose)
+      MakeDelaunayByDiagonalFlipping<KERNEL>(mesh);
+
+    renderStage(RENDER_CDT, "-CDT");
+  }
+  const std::string stage = options.delaunay ? "-CDT" : "-CT";
+  const bool written = writeMesh(dir+"/"+name+stage+meshFormatExtension(options.format), mesh, options.format) == 0;
+  return written && saved;
+}
+
+// Settings of a run given on the command line, see ParseCommandLine().
+struct CommandLine
+{
+	std::string					kernel		= "adaptive";
+	std::string					engine		= "ears";
+	RunOptions					run;
+	uint16_t					width		= 800;
+	uint16_t					height		= 800;
+	unsigned					nThreads	= std::thread::hardware_concurrency();
+	unsigned					memoryMB	= 256;		// budget of the stream engine, see StreamingEarClipper
+	bool						fromSnapshot = false;	// the inputs are snapshots to flip, see FlipSnapshots()
+	std::string					outputDir;				// named after the kernel if empty
+	bool						wait		= false;	// for Enter before exiting
+	bool						help		= false;
+	std::vector<std::string>	inputs;
+};
+
+inline void PrintUsage(const char *program)
+{
+	std::cout <<
+		"Usage: " << program << " [options] [input ...]\n"
+		"Triangulates simple polygons to constrained Delaunay triangulations.\n"
+		"An input is a polygon file (.txt, .bpoly or .qpoly), a .txt file may be given without its extension,\n"
+		"a .mpoly file of many polygons, whose triangles are all written to one -CDT.tri or -CT.tri file without images,\n"
+		"or a directory, whose polygon files are all triangulated. The default input is simple_polygon_0.\n"
+		"Options:\n"
+		"  --kernel K      predicates: float, double (both naive), adaptive or exact (both exact on doubles), default adaptive\n"
+		"  --engine E      ears: ear cutting of one input after another, on all threads for large polygons (default)\n"
+		"                  decomposition: domain decomposition on all threads, one input after another\n"
+		"                  batch: many inputs concurrently, one per thread, no images\n"
+		"                  pipeline: reading, ear cutting, flipping and writing overlapped, no images\n"
+		"                  stream: out-of-core ear cutting of .txt or .bpoly inputs too large for memory, no flipping\n"
+		"                  and no images, the triangles are written as -CT.tri whatever --stages and --format say\n"
+		"  --stages S      ct: stop after the ear cutting, cdt: flip to Delaunay as well (default)\n"
+		"  --render S,...  images of the stages input, ct and cdt only, or all (default)\n"
+		"  --no-render     no images at all, not even allocated\n"
+		"  --size WxH      of the images, default 800x800\n"
+		"  --format F      of the triangulation: ply (default), obj, tri (uint32 index triples) or none\n"
+		"  --threads N     default: all cores\n"
+		"  --memory MB     budget of the stream engine, default 256\n"
+		"  --output DIR    for all the files written, created if missing, default: named after the kernel\n"
+		"  --reorder       renumber the triangulation along a Hilbert curve before flipping\n"
+		"  --save-snapshot save the mesh after the ear cutting as -CT.msnap, ears and decomposition engines only\n"
+		"  --from-snapshot the inputs are .msnap files saved so, only flipped to Delaunay with their constraints kept\n"
+		"                  and written as -CDT, whatever the engine and --stages, no images\n"
+		"  --print-points  print the input points\n"
+		"  --wait          wait for Enter before exiting\n"
+		"  --help\n";
+}
 
-  image.erase();
-  drawMesh(mesh, image);
-  image.write((dir+"/"+filename+"-input"+".tga").c_str());
+/** Reads the options and inputs from the command line, see PrintUsage().
+ *  @return false after reporting an invalid option to cerr
+ */
+inline bool ParseCommandLine(const int argc, char *argv[], CommandLine &commandLine)
+{
+	auto number = [](const std::string &text, unsigned &value) {
+		const std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	};
+	for (int i = 1; i < argc; ++ i) {
+		const std::string arg = argv[i];
+		if (arg.size() < 2 || arg[0] != '-') {
+			commandLine.inputs.push_back(arg);
+			continue;
+		}
+		if (arg == "--help" || arg == "-h") {
+			commandLine.help = true;
+			continue;
+		}
+		if (arg == "--no-render") {
+			commandLine.run.render = 0;
+			continue;
+		}
+		if (arg == "--reorder") {
+			commandLine.run.reorder = true;
+			continue;
+		}
+		if (arg == "--print-points") {
+			commandLine.run.printPoints = true;
+			continue;
+		}
+		if (arg == "--save-snapshot") {
+			commandLine.run.saveSnapshot = true;
+			continue;
+		}
+		if (arg == "--from-snapshot") {
+			commandLine.fromSnapshot = true;
+			continue;
+		}
+		if (arg == "--wait") {
+			commandLine.wait = true;
+			continue;
+		}
+
+		// All the other options take a value.
+		if (i + 1 == argc) {
+			std::cerr << "Error: " << arg << " needs a value" << std::endl;
+			return false;
+		}
+		const std::string value = argv[++ i];
+		bool valid = true;
+		if (arg == "--kernel") {
+			commandLine.kernel = value;
+			valid = value == "float" || value == "double" || value == "adaptive" || value == "exact";
+		} else if (arg == "--engine") {
+			commandLine.engine = value;
+			valid = value == "ears" || value == "decomposition" || value == "batch" || value == "pipeline" || value == "stream";
+			commandLine.run.engine = (value == "decomposition") ? ENGINE_DOMAIN_DECOMPOSITION : ENGINE_EAR_CUTTING;
+		} else if (arg == "--render") {
+			// A comma separated list of the stages.
+			commandLine.run.render = 0;
+			for (size_t first = 0; valid && first <= value.size(); ) {
+				const size_t last = std::min(value.find(',', first), value.size());
+				const std::string stage = value.substr(first, last - first);
+				if (stage == "input")
+					commandLine.run.render |= RENDER_INPUT;
+				else if (stage == "ct")
+					commandLine.run.render |= RENDER_CT;
+				else if (stage == "cdt")
+					commandLine.run.render |= RENDER_CDT;
+				else if (stage == "all")
+					commandLine.run.render |= RENDER_ALL;
+				else
+					valid = false;
+				first = last + 1;
+			}
+		} else if (arg == "--stages") {
+			commandLine.run.delaunay = value == "cdt";
+			valid = value == "ct" || value == "cdt";
+		} else if (arg == "--size") {
+			const size_t x = value.find('x');
+			unsigned width = 0, height = 0;
+			valid = x != std::string::npos && number(value.substr(0, x), width) && number(value.substr(x + 1), height) &&
+				width > 0 && width <= UINT16_MAX && height > 0 && height <= UINT16_MAX;
+			commandLine.width  = uint16_t(width);
+			commandLine.height = uint16_t(height);
+		} else if (arg == "--format") {
+			valid = value == "ply" || value == "obj" || value == "tri" || value == "none";
+			commandLine.run.format = (value == "ply") ? MESH_FORMAT_PLY : (value == "obj") ? MESH_FORMAT_OBJ :
+				(value == "tri") ? MESH_FORMAT_TRI : MESH_FORMAT_NONE;
+		} else if (arg == "--threads") {
+			valid = number(value, commandLine.nThreads) && commandLine.nThreads > 0;
+		} else if (arg == "--memory") {
+			valid = number(value, commandLine.memoryMB) && commandLine.memoryMB > 0;
+		} else if (arg == "--output") {
+			commandLine.outputDir = value;
+		} else {
+			std::cerr << "Error: unknown option " << arg << std::endl;
+			return false;
+		}
+		if (! valid) {
+			std::cerr << "Error: invalid value " << value << " of " << arg << std::endl;
+			return false;
+		}
+	}
+	if (commandLine.inputs.empty() && commandLine.fromSnapshot) {
+		std::cerr << "Error: --from-snapshot needs the .msnap files as inputs" << std::endl;
+		return false;
+	}
+	if (commandLine.inputs.empty())
+		commandLine.inputs.push_back("simple_polygon_0");
+	return true;
+}
 
-  TriangulateFaceByEarCutting<KERNEL>(mesh, fh);
+/** Flip each mesh snapshot saved by testCDT() after the ear cutting to a constrained Delaunay triangulation,
+ *  keeping the edges flagged as constraints in it. The snapshot dir/name-CT.msnap, or dir/name.msnap,
+ *  is written to outputDir/name-CDT with the extension of the format.
+ *  @return number of files which failed
+ */
+template <class KERNEL>
+int FlipSnapshots(const std::vector<std::string> &files, const std::string &outputDir, const MeshFormat format)
+{
+	SetBatchRounding<KERNEL>();
+	typename KERNEL::MeshType mesh;
+	std::vector<char> constrained;
+	int nFailed = 0;
+	for (const std::string &file : files) {
+		std::cout << "Input: " << file << std::endl;
+		if (loadMeshSnapshot(file, mesh, &constrained) != 0) {
+			++ nFailed;
+			continue;
+		}
+		std::string name = std::filesystem::path(file).stem().string();
+		if (hasExtension(name, "-CT"))
+			name.resize(name.size() - 3);
+		size_t nFlips = 0;
+		MakeDelaunayByDiagonalFlipping<KERNEL>(mesh, nullptr, &constrained, &nFlips);
+		std::cout << nFlips << " flips" << std::endl;
+		if (writeMesh((std::filesystem::path(outputDir) / (name + "-CDT" + meshFormatExtension(format))).string(), mesh, format) != 0)
+			++ nFailed;
+	}
+	if (files.size() > 1)
+		std::cout << files.size() - nFailed << " of " << files.size() << " files triangulated" << std::endl;
+	return nFailed;
+}
 
-  image.erase();
-  drawMesh(mesh, image);
-  image.write((dir+"/"+filename+"-CT"+".tga").c_str());
+/** Triangulate each file by a StreamingEarClipper within memoryBudget bytes, the triangles of dir/name.ext
+ *  are written to outputDir/name-CT.tri. Only .txt and .bpoly files can be streamed.
+ *  @return number of files which failed
+ */
+template <class KERNEL>
+int StreamFiles(const std::vector<std::string> &files, const std::string &outputDir, const size_t memoryBudget)
+{
+	SetBatchRounding<KERNEL>();
+	int nFailed = 0;
+	for (const std::string &file : files) {
+		std::cout << "Input: " << file << std::endl;
+		const bool text = hasExtension(file, ".txt");
+		if (! text && ! hasExtension(file, ".bpoly")) {
+			std::cerr << "Error: " << file << ": only .txt and .bpoly files can be streamed" << std::endl;
+			++ nFailed;
+			continue;
+		}
+		const std::string output = (std::filesystem::path(outputDir) / (std::filesystem::path(file).stem().string() + "-CT")).string();
+		StreamingEarClipper<KERNEL> clipper(memoryBudget);
+		const long long nTriangles = clipper.triangulate(text ? file.substr(0, file.size() - 4) : file, output);
+		if (nTriangles < 0)
+			++ nFailed;
+		else
+			std::cout << nTriangles << " triangles written to " << output << ".tri, at most " << clipper.capacity()
+				<< " vertices in memory" << std::endl;
+	}
+	if (files.size() > 1)
+		std::cout << files.size() - nFailed << " of " << files.size() << " files triangulated" << std::endl;
+	return nFailed;
+}
 
-  MakeDelaunayByDiagonalFlipping<KERNEL>(mesh);
+/** Runs what the command line asks for with the given kernel.
+ *  @return exit code of the program, 0 if all the inputs were triangulated and written
+ */
+template <class KERNEL>
+int RunCommandLine(const CommandLine &commandLine)
+{
+	const std::string dir = commandLine.outputDir.empty() ? commandLine.kernel : commandLine.outputDir;
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (ec) {
+		std::cerr << "Cannot create " << dir << ": " << ec.message() << std::endl;
+		return 1;
+	}
+	ThreadPool pool(commandLine.nThreads);
+	const RunOptions &options = commandLine.run;
+
+	if (commandLine.fromSnapshot)
+		return FlipSnapshots<KERNEL>(commandLine.inputs, dir, options.format) == 0 ? 0 : 1;
+	if (commandLine.engine == "batch")
+		return TriangulateBatch<KERNEL>(commandLine.inputs, dir, pool, options.delaunay, options.format) == 0 ? 0 : 1;
+	if (commandLine.engine == "pipeline")
+		return TriangulateBatchPipelined<KERNEL>(commandLine.inputs, dir, &pool, options.delaunay, options.format) == 0 ? 0 : 1;
+
+	if (commandLine.engine == "stream") {
+		std::vector<std::string> files;
+		if (! ExpandBatchInputs(commandLine.inputs, files))
+			return 1;
+		return StreamFiles<KERNEL>(files, dir, size_t(commandLine.memoryMB) << 20) == 0 ? 0 : 1;
+	}
 
-  image.erase();
-  drawMesh(mesh, image);
-  image.write((dir+"/"+filename+"-CDT"+".tga").c_str());
+	// The outputs are named as in a batch, an input whose output name is taken by one before it fails.
+	std::vector<BatchFileResult> files;
+	if (! CollectBatchFiles(commandLine.inputs, dir, options.delaunay, options.format, files))
+		return 1;
+	// Shared by all the inputs, and only there if anything is drawn at all.
+	// One writer for all the inputs, the images of one are written while the next is triangulated.
+	std::unique_ptr<Image> image;
+	std::unique_ptr<AsyncImageWriter> imageWriter;
+	if (options.render != 0) {
+		image.reset(new Image(commandLine.width, commandLine.height));
+		imageWriter.reset(new AsyncImageWriter);
+	}
+	int nFailed = 0;
+	for (const BatchFileResult &batchFile : files) {
+		const std::string &file = batchFile.input;
+		if (batchFile.output.empty()) {
+			std::cerr << "Error: " << file << ": " << batchFile.status << std::endl;
+			++ nFailed;
+			continue;
+		}
+		if (hasExtension(file, ".mpoly")) {
+			std::cout << "Input: " << file << std::endl;
+			const std::string output = (options.format == MESH_FORMAT_NONE) ? std::string() : batchFile.output;
+			MultiPolygonResult result;
+			const long long nTriangles = TriangulateMultiPolygonFile<KERNEL>(file, output, options.delaunay, nullptr, &result);
+			if (nTriangles < 0 || result.nFailed > 0)
+				++ nFailed;
+			if (nTriangles >= 0)
+				std::cout << nTriangles << " triangles of " << result.nPolygons - result.nFailed << " of " << result.nPolygons << " polygons" << std::endl;
+			continue;
+		}
+		// A text file is named without its extension for loadPoints().
+		const std::string name = hasExtension(file, ".txt") ? file.substr(0, file.size() - 4) : file;
+		if (! testCDT<KERNEL>(dir, name, image.get(), imageWriter.get(), &pool, options))
+			++ nFailed;
+	}
+	// The images that cannot be written are reported to cerr by the writer, they fail the run but no triangulation.
+	const bool imagesWritten = ! imageWriter || imageWriter->finish();
+	if (files.size() > 1)
+		std::cout << files.size() - nFailed << " of " << files.size() << " files triangulated" << std::endl;
+	return (nFailed == 0 && imagesWritten) ? 0 : 1;
 }
 
 #ifdef GENERATE_POLYGONS
 #endif // GENERATE_POLYGONS
 
-int main()
+// TEST DIFFERENT PRECISION on float and double
+// The kernels of --kernel: float and double are naive, adaptive (the default) and exact give the same signs on doubles.
+// Adaptive only falls back to exact arithmetic near zero, exact always evaluates it, e.g. to time the expansions.
+typedef Kernel<float,  Orient2dNaive<float>,     Extended2dNaive<float>,  InCircleNaive<float>>     KernelFloatInexact2;
+typedef Kernel<double, Orient2dNaive<double>,    Extended2dNaive<double>, InCircleNaive<double>>    KernelDoubleInexact2;
+typedef Kernel<double, Orient2dAdaptive<double>, Extended2dExact<double>, InCircleAdaptive<double>> KernelDoubleAdaptiveShewchuk;
+typedef Kernel<double, Orient2dExact<double>,    Extended2dExact<double>, InCircleExact<double>>    KernelDoubleExactShewchuk;
+typedef Kernel<double, Orient2dAdaptive<double>, Extended2dExact<double>, InCircleAdaptive<double>, CompactTriMesh<double>> KernelDoubleAdaptiveCompact;
+
+#ifdef BENCHMARK_SCALING
+// Built by make bench_scaling: main() runs BenchmarkScaling() instead of the command line.
+
+#include <random>
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Calls of the predicates in the current run. The benchmark runs on one thread.
+struct PredicateCalls
+{
+	uint64_t	orient		= 0;
+	uint64_t	extended	= 0;
+	uint64_t	inCircle	= 0;
+};
+static PredicateCalls predicateCalls;
+
+// Predicate counting its calls in the member COUNTER of predicateCalls.
+template<typename PREDICATE, uint64_t PredicateCalls::*COUNTER>
+struct CountedPredicate : PREDICATE
+{
+	template<typename... Args>
+	auto operator()(const Args&... args) { ++ (predicateCalls.*COUNTER); return PREDICATE::operator()(args...); }
+};
+
+// KERNEL with all its predicates counted.
+template<typename KERNEL>
+using CountingKernel = Kernel<typename KERNEL::FloatType, CountedPredicate<typename KERNEL::Orient, &PredicateCalls::orient>,
+	CountedPredicate<typename KERNEL::Extended, &PredicateCalls::extended>,
+	CountedPredicate<typename KERNEL::InCircle, &PredicateCalls::inCircle>, typename KERNEL::MeshType>;
+
+// Peak resident set size of the process so far in bytes, 0 if unknown.
+inline uint64_t PeakRssBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? uint64_t(counters.PeakWorkingSetSize) : 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#if defined(__APPLE__)
+	return uint64_t(usage.ru_maxrss);
+#else
+	return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Star shaped polygon of n vertices in counterclockwise order: at n equally spaced angles around the origin,
+// at a random distance from 0.5 to 1. The same n and seed give the same polygon.
+template<typename T>
+void GenerateStarPolygon(const size_t n, const uint64_t seed, std::vector<VectorT<T, 2>> &points)
+{
+	constexpr double pi = 3.14159265358979323846;
+	std::mt19937_64 rng(seed);
+	std::uniform_real_distribution<double> radius(0.5, 1.);
+	points.resize(n);
+	for (size_t i = 0; i < n; ++ i) {
+		const double angle = 2. * pi * double(i) / double(n);
+		const double r = radius(rng);
+		points[i] = VectorT<T, 2>(T(r * cos(angle)), T(r * sin(angle)));
+	}
+}
+
+/** Triangulate a star polygon of n vertices with KERNEL on one thread and print a JSON object of the run:
+ *  the time of each stage in total and per vertex, the flips, the predicate calls and the peak RSS of the process so far.
+ */
+template<typename KERNEL>
+void BenchmarkScalingRun(const char *kernelName, const size_t n)
+{
+	typedef CountingKernel<KERNEL>						Counting;
+	typedef typename Counting::MeshType					MeshType;
+	typedef VectorT<typename KERNEL::FloatType, 2>		VecType;
+	typedef std::chrono::steady_clock					Clock;
+	auto seconds = [](const Clock::time_point from, const Clock::time_point to) { return std::chrono::duration<double>(to - from).count(); };
+
+	if (sizeof(typename KERNEL::FloatType) == 4)
+		ExactPredicates::setFPURoundingTo24Bits();
+	else
+		ExactPredicates::setFPURoundingTo53Bits();
+
+	std::vector<VecType> points;
+	GenerateStarPolygon(n, 1, points);
+	predicateCalls = PredicateCalls();
+
+	const Clock::time_point t0 = Clock::now();
+	MeshType mesh;
+	std::vector<typename MeshType::VertexHandle> vertices;
+	vertices.reserve(n);
+	for (const VecType &p : points)
+		vertices.push_back(mesh.add_vertex(p));
+	const typename MeshType::FaceHandle fh = mesh.add_face(vertices);
+	const Clock::time_point t1 = Clock::now();
+	const bool complete = TriangulateFaceByEarCutting<Counting>(mesh, fh);
+	const Clock::time_point t2 = Clock::now();
+	size_t nFlips = 0;
+	if (complete)
+		MakeDelaunayByDiagonalFlipping<Counting>(mesh, nullptr, nullptr, &nFlips);
+	const Clock::time_point t3 = Clock::now();
+
+	const double build = seconds(t0, t1), earCutting = seconds(t1, t2), flipping = seconds(t2, t3);
+	const double perVertex = 1e9 / double(n);
+	std::cout << std::fixed << "{\"kernel\": \"" << kernelName << "\", \"vertices\": " << n
+		<< ", \"complete\": " << (complete ? "true" : "false") << ", \"triangles\": " << mesh.n_faces()
+		<< std::setprecision(6) << ", \"seconds\": {\"build\": " << build << ", \"earCutting\": " << earCutting
+		<< ", \"flipping\": " << flipping << "}"
+		<< std::setprecision(2) << ", \"nsPerVertex\": {\"build\": " << build * perVertex
+		<< ", \"earCutting\": " << earCutting * perVertex << ", \"flipping\": " << flipping * perVertex << "}"
+		<< ", \"flips\": " << nFlips << ", \"predicates\": {\"orient\": " << predicateCalls.orient
+		<< ", \"extended\": " << predicateCalls.extended << ", \"inCircle\": " << predicateCalls.inCircle << "}"
+		<< ", \"peakRssBytes\": " << PeakRssBytes() << "}" << std::defaultfloat;
+}
+
+/** Runs the ear cutting and the flipping of star polygons of 10^2 up to maxVertices (default 10^7) vertices
+ *  with each kernel and prints the runs as JSON to stdout, one run per line as soon as it is done.
+ *  The sizes grow from run to run, so the peak RSS so far is the one of the largest run so far.
+ */
+int BenchmarkScaling(int argc, char *argv[])
+{
+	const size_t maxVertices = (argc > 1) ? size_t(strtoull(argv[1], nullptr, 10)) : size_t(10000000);
+	if (maxVertices < 3) {
+		std::cerr << "Usage: " << argv[0] << " [maximum number of vertices, default 10000000]" << std::endl;
+		return 2;
+	}
+
+	std::cout << "{\"benchmark\": \"scaling\", \"polygon\": \"star\", \"threads\": 1, \"runs\": [\n";
+	bool first = true;
+	auto run = [&first](auto kernel, const char *name, const size_t n) {
+		std::cout << (first ? "  " : ",\n  ");
+		first = false;
+		BenchmarkScalingRun<decltype(kernel)>(name, n);
+		std::cout.flush();
+	};
+	for (size_t n = 100; n <= maxVertices; n *= 10) {
+		run(KernelFloatInexact2(),			"KernelFloatInexact2",			n);
+		run(KernelDoubleInexact2(),			"KernelDoubleInexact2",			n);
+		run(KernelDoubleAdaptiveShewchuk(),	"KernelDoubleAdaptiveShewchuk",	n);
+		run(KernelDoubleExactShewchuk(),	"KernelDoubleExactShewchuk",	n);
+		run(KernelDoubleAdaptiveCompact(),	"KernelDoubleAdaptiveCompact",	n);
+	}
+	std::cout << "\n]}" << std::endl;
+	return 0;
+}
+#endif // BENCHMARK_SCALING
+
+int main(int argc, char *argv[])
 {
   // Shewchuk exact predicate arithmetic initialization - DO NOT FORGET!!!
   ExactPredicates::exactinit();
 
+#ifdef BENCHMARK_SCALING
+  return BenchmarkScaling(argc, argv);
+#endif
 
-  // TEST DIFFERENT PRECISION on float and double
-  Image image(800, 800);
+  CommandLine commandLine;
+  if (! ParseCommandLine(argc, argv, commandLine)) {
+    std::cerr << "See " << argv[0] << " --help" << std::endl;
+    return 2;
+  }
+  if (commandLine.help) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
 
-  typedef Kernel<float,  Orient2dNaive<float>,   Extended2dNaive<float>,	InCircleNaive<float>>	  KernelFloatInexact2;
-  typedef Kernel<double, Orient2dNaive<double>,  Extended2dNaive<double>,	InCircleNaive<double>>	KernelDoubleInexact2;
-  typedef Kernel<double, Orient2dExact<double>,  Extended2dExact<double>,	InCircleExact<double>>	KernelDoubleAdaptiveShewchuk;
+  int exitCode;
+  if (commandLine.kernel == "float")
+    exitCode = RunCommandLine<KernelFloatInexact2>(commandLine);
+  else if (commandLine.kernel == "double")
+    exitCode = RunCommandLine<KernelDoubleInexact2>(commandLine);
+  else if (commandLine.kernel == "exact")
+    exitCode = RunCommandLine<KernelDoubleExactShewchuk>(commandLine);
+  else
+    exitCode = RunCommandLine<KernelDoubleAdaptiveShewchuk>(commandLine);
 
-  std::string inputFile = "simple_polygon_0";
-  testCDT<KernelDoubleAdaptiveShewchuk>("adaptive", inputFile, image);
+  if (commandLine.wait) {
+    std::cout << "Press Enter to exit ..." << std::endl;
+    std::cin.get();
+  }
+  return exitCode;
 
+  // Compare the kernels on the test polygons.
+  // Image image(800, 800);
   // for( int i = 1; i <=5; i++ )
   // { 
-  //   //std::string inputFile = "points" + std::to_string(i);  // for VS2012 - correct std string
-  //   std::string inputFile = "simple_polygon_" + std::to_string(static_cast<long long>(i)); // for VS2010 - wrong std string
-
-  //   testCDT<KernelDoubleAdaptiveShewchuk>( "adaptive", inputFile, image );
-  //   testCDT<KernelFloatInexact2>( "float", inputFile, image );
-  //   testCDT<KernelDoubleInexact2>( "double", inputFile, image );
+  //   std::string inputFile = "simple_polygon_" + std::to_string(i);
+  //   testCDT<KernelDoubleAdaptiveShewchuk>( "adaptive", inputFile, &image );
+  //   testCDT<KernelFloatInexact2>( "float", inputFile, &image );
+  //   testCDT<KernelDoubleInexact2>( "double", inputFile, &image );
+  //   testCDT<KernelDoubleAdaptiveCompact>( "compact", inputFile, &image );
   // }
-
-  std::cout << "Press Enter to exit ..." << std::endl;
-  std::cin.get();
-
-  return 0;
 }
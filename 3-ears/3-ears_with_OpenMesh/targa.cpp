@@ -538,7 +538,7 @@ tga_result tga_write_to_FILE(FILE *fp, const tga_image *src)
         for (row=0; row<src->height; row++)
         {
             tga_result result = tga_write_row_RLE(fp, src,
-                src->image_data + row*src->width*src->pixel_depth/8);
+                src->image_data + (size_t)row*src->width*src->pixel_depth/8);
             if (result != TGA_NOERR) return result;
         }
     }
@@ -546,7 +546,7 @@ tga_result tga_write_to_FILE(FILE *fp, const tga_image *src)
     {
         /* uncompressed */
         WRITE(src->image_data,
-              src->width * src->height * src->pixel_depth / 8);
+              (size_t)src->width * src->height * src->pixel_depth / 8);
     }
 
     WRITE(tga_id, tga_id_length);
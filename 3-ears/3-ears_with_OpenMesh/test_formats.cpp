@@ -0,0 +1,292 @@
+/* test_formats.cpp
+*
+* Checks of the file formats: write and read back .bpoly, .qpoly, .mpoly and .msnap files, the parallel
+* text reader against the sequential one including the line numbers of its errors, and the rejection
+* of truncated and damaged files.
+*
+* Build and run: make test
+* Prints one line per check and exits with 1 if any failed. The files are written to test_formats.tmp/.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CompactTriMesh.h"
+#include "MeshSnapshot.h"
+#include "PolygonFormats.h"
+#include "ThreadPool.h"
+
+typedef OpenMesh::VectorT<double, 2>	Vec2d;
+typedef OpenMesh::VectorT<float, 2>		Vec2f;
+
+// loadPoints() only needs the float type of a kernel.
+struct DoubleKernel { typedef double FloatType; };
+
+static const std::string directory = "test_formats.tmp";
+static int nFailed = 0;
+
+static void check(const bool passed, const char *what)
+{
+	printf("%-64s %s\n", what, passed ? "ok" : "FAILED");
+	if (! passed)
+		++ nFailed;
+}
+
+static std::string path(const std::string &name) { return directory + "/" + name; }
+
+static std::string readFile(const std::string &fileName)
+{
+	std::ifstream in(fileName, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string &fileName, const std::string &data)
+{
+	std::ofstream(fileName, std::ios::binary) << data;
+}
+
+// What the call writes to cerr, e.g. the error of a rejected file.
+template<typename Fn>
+static std::string capturedErrors(Fn fn)
+{
+	std::ostringstream errors;
+	std::streambuf *const old = std::cerr.rdbuf(errors.rdbuf());
+	fn();
+	std::cerr.rdbuf(old);
+	return errors.str();
+}
+
+// Random points on the grid of step 1/4, so they are exact in float, double and a .qpoly file of that step.
+static std::vector<Vec2d> gridPoints(const size_t n, const uint64_t seed)
+{
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<int> coordinate(-100000, 100000);
+	std::vector<Vec2d> points(n);
+	for (Vec2d &p : points)
+		p = Vec2d(coordinate(rng) * 0.25, coordinate(rng) * 0.25);
+	return points;
+}
+
+static void testBinaryPolygon()
+{
+	const std::vector<Vec2d> points = gridPoints(1000, 1);
+	std::vector<Vec2f> pointsF;
+	for (const Vec2d &p : points)
+		pointsF.push_back(Vec2f(float(p[0]), float(p[1])));
+
+	BinaryPolygonFile file;
+	check(writeBinaryPolygon(path("d.bpoly"), points.begin(), points.end()) == 0 && file.open(path("d.bpoly")) &&
+		file.size() == points.size() && file.points<double>() != nullptr && file.points<float>() == nullptr &&
+		std::equal(points.begin(), points.end(), file.points<double>()), ".bpoly of doubles read back in place");
+	check(writeBinaryPolygon(path("f.bpoly"), pointsF.begin(), pointsF.end()) == 0 && file.open(path("f.bpoly")) &&
+		file.point<double>(999) == points[999], ".bpoly of floats read back converted");
+	std::vector<Vec2d> loaded;
+	check(loadPoints<DoubleKernel>(path("f.bpoly"), loaded) == int64_t(points.size()) && loaded == points, ".bpoly read by loadPoints()");
+
+	const std::string data = readFile(path("d.bpoly"));
+	writeFile(path("truncated.bpoly"), data.substr(0, data.size() - 1));
+	writeFile(path("header.bpoly"), data.substr(0, 40));
+	std::string magic = data;
+	magic[0] = 'X';
+	writeFile(path("magic.bpoly"), magic);
+	bool rejected = true;
+	const std::string errors = capturedErrors([&]() {
+		for (const char *name : { "truncated.bpoly", "header.bpoly", "magic.bpoly" })
+			rejected = rejected && ! file.open(path(name));
+	});
+	check(rejected && errors.find("size does not match") != std::string::npos, "truncated or damaged .bpoly rejected");
+}
+
+static void testQuantizedPolygon()
+{
+	const std::vector<Vec2d> points = gridPoints(1000, 2);
+	QuantizedPolygonFile file;
+	std::vector<Vec2d> decoded;
+	check(writeQuantizedPolygon(path("p.qpoly"), points.begin(), points.end(), 0.25) == 0 && file.open(path("p.qpoly")) &&
+		file.size() == points.size() && file.decode<double>(std::back_inserter(decoded)) && decoded == points,
+		".qpoly of grid points read back exactly");
+
+	const std::string data = readFile(path("p.qpoly"));
+	writeFile(path("truncated.qpoly"), data.substr(0, data.size() - 1));
+	std::string count = data;
+	const uint64_t hugeCount = uint64_t(1) << 60;
+	memcpy(&count[offsetof(QuantizedPolygonHeader, count)], &hugeCount, sizeof(hugeCount));
+	writeFile(path("count.qpoly"), count);
+	std::string step = data;
+	const double zero = 0.;
+	memcpy(&step[offsetof(QuantizedPolygonHeader, step)], &zero, sizeof(zero));
+	writeFile(path("step.qpoly"), step);
+
+	bool rejected = true;
+	const std::string errors = capturedErrors([&]() {
+		QuantizedPolygonFile truncated;
+		decoded.clear();
+		rejected = truncated.open(path("truncated.qpoly")) && ! truncated.decode<double>(std::back_inserter(decoded));
+		rejected = rejected && ! file.open(path("count.qpoly")) && ! file.open(path("step.qpoly"));
+	});
+	check(rejected && errors.find("invalid point count") != std::string::npos && errors.find("truncated") != std::string::npos,
+		"truncated .qpoly and damaged headers rejected");
+}
+
+static void testMultiPolygon()
+{
+	std::vector<std::vector<Vec2d>> rings;
+	for (size_t i = 0; i < 100; ++ i)
+		rings.push_back(gridPoints(3 + i % 7, 100 + i));
+	rings.push_back(std::vector<Vec2d>());
+
+	MultiPolygonWriter<double> writer;
+	bool written = writer.open(path("r.mpoly"));
+	for (const std::vector<Vec2d> &ring : rings)
+		writer.add(ring.begin(), ring.end());
+	written = writer.close() == 0 && written;
+
+	MultiPolygonFile file;
+	bool same = written && file.open(path("r.mpoly")) && file.size() == rings.size();
+	size_t first = 0;
+	for (size_t i = 0; same && i < rings.size(); ++ i) {
+		std::vector<Vec2f> converted;
+		file.copyPolygon<float>(i, std::back_inserter(converted));
+		same = file.polygonSize(i) == rings[i].size() && file.firstPoint(i) == first && converted.size() == rings[i].size() &&
+			std::equal(rings[i].begin(), rings[i].end(), file.points<double>(i));
+		first += rings[i].size();
+	}
+	check(same, ".mpoly rings read back in place and converted");
+
+	// nPolygons + 1 index entries of 8 bytes wrap to an empty index for this count.
+	const std::string data = readFile(path("r.mpoly"));
+	std::string overflow = data;
+	MultiPolygonTrailer trailer;
+	memcpy(&trailer, &overflow[overflow.size() - sizeof(trailer)], sizeof(trailer));
+	trailer.nPolygons	= (uint64_t(1) << 61) - 1;
+	trailer.indexOffset	= overflow.size() - sizeof(trailer);
+	memcpy(&overflow[overflow.size() - sizeof(trailer)], &trailer, sizeof(trailer));
+	writeFile(path("overflow.mpoly"), overflow);
+	writeFile(path("truncated.mpoly"), data.substr(0, data.size() - 1));
+	std::string index = data;
+	index[index.size() - sizeof(trailer) - 8] ^= 1;
+	writeFile(path("index.mpoly"), index);
+
+	bool rejected = true;
+	const std::string errors = capturedErrors([&]() {
+		for (const char *name : { "overflow.mpoly", "truncated.mpoly", "index.mpoly" })
+			rejected = rejected && ! file.open(path(name));
+	});
+	check(rejected && errors.find("damaged index") != std::string::npos, "truncated .mpoly and damaged indices rejected");
+}
+
+static void testMeshSnapshot()
+{
+	typedef CompactTriMesh<double>	Mesh;
+	typedef Mesh::HalfedgeHandle	HH;
+
+	// A hexagon cut into a fan of four triangles.
+	Mesh mesh;
+	std::vector<Mesh::VertexHandle> vertices;
+	for (int i = 0; i < 6; ++ i)
+		vertices.push_back(mesh.add_vertex(Mesh::Point(cos(i * 1.0471975511965976), sin(i * 1.0471975511965976))));
+	const Mesh::FaceHandle fh = mesh.add_face(vertices);
+	// The halfedge into vertex 0 stays in the face which is left to cut, each diagonal leaves a triangle behind.
+	const HH into0 = mesh.prev_halfedge_handle(mesh.halfedge_handle(fh));
+	HH diagonal = mesh.halfedge_handle(fh);
+	for (int i = 0; i < 3; ++ i)
+		diagonal = mesh.insert_edge(into0, mesh.next_halfedge_handle(mesh.next_halfedge_handle(diagonal)));
+	std::vector<char> constrained(mesh.n_edges(), 0);
+	constrained[1] = constrained[7] = 1;
+
+	Mesh loaded;
+	std::vector<char> loadedConstraints;
+	bool same = saveMeshSnapshot(path("m.msnap"), mesh, &constrained) == 0 &&
+		loadMeshSnapshot(path("m.msnap"), loaded, &loadedConstraints) == 0 && loadedConstraints == constrained &&
+		loaded.n_vertices() == mesh.n_vertices() && loaded.n_edges() == mesh.n_edges() && loaded.n_faces() == 4;
+	for (int i = 0; same && i < int(mesh.n_halfedges()); ++ i)
+		same = loaded.next_halfedge_handle(HH(i)) == mesh.next_halfedge_handle(HH(i)) &&
+			loaded.prev_halfedge_handle(HH(i)) == mesh.prev_halfedge_handle(HH(i)) &&
+			loaded.face_handle(HH(i)) == mesh.face_handle(HH(i)) && loaded.to_vertex_handle(HH(i)) == mesh.to_vertex_handle(HH(i));
+	check(same && saveMeshSnapshot(path("again.msnap"), loaded, &loadedConstraints) == 0 &&
+		readFile(path("again.msnap")) == readFile(path("m.msnap")), ".msnap read back with the same handles and constraints");
+
+	const std::string data = readFile(path("m.msnap"));
+	writeFile(path("truncated.msnap"), data.substr(0, data.size() - 8));
+	std::string handle = data;
+	const int32_t outside = 1000;
+	memcpy(&handle[sizeof(MeshSnapshotHeader) + 6 * 2 * sizeof(double)], &outside, sizeof(outside));
+	writeFile(path("handle.msnap"), handle);
+
+	CompactTriMesh<float> meshF;
+	bool rejected = true;
+	const std::string errors = capturedErrors([&]() {
+		for (const char *name : { "truncated.msnap", "handle.msnap" })
+			rejected = rejected && loadMeshSnapshot(path(name), loaded) != 0 && loaded.n_vertices() == 0;
+		rejected = rejected && loadMeshSnapshot(path("m.msnap"), meshF) != 0;
+	});
+	check(rejected && errors.find("handle out of range") != std::string::npos, "truncated, damaged or mistyped .msnap rejected");
+}
+
+static void testParallelText()
+{
+	// Large enough for a chunk per thread of 1MB at least.
+	const std::vector<Vec2d> points = gridPoints(300000, 3);
+	BufferedWriter out;
+	bool written = out.open(path("big.txt"));
+	for (const Vec2d &p : points) {
+		out.number(p[0]);
+		out.put(' ');
+		out.number(p[1]);
+		out.put('\n');
+	}
+	written = out.close() && written;
+
+	ThreadPool pool(4);
+	std::vector<Vec2d> sequential, parallel;
+	check(written && loadPoints<DoubleKernel>(path("big"), sequential) == int64_t(points.size()) &&
+		loadPoints<DoubleKernel>(path("big"), parallel, &pool) == int64_t(points.size()) && sequential == points && parallel == points,
+		"text read in parallel chunks as sequentially");
+
+	// An error near the end, in the last chunk, and one in the first on line 4.
+	std::string text = readFile(path("big.txt"));
+	std::string late = text;
+	const size_t lateLine = 299000;
+	size_t at = 0;
+	for (size_t line = 1; line < lateLine; ++ line)
+		at = late.find('\n', at) + 1;
+	late.insert(at, "1 x\n");
+	writeFile(path("late.txt"), late);
+	writeFile(path("early.txt"), "0 0\n1 0\n\n0 1x\n" + text);
+
+	for (const char *name : { "late", "early" }) {
+		std::string errors[2];
+		int64_t results[2];
+		errors[0] = capturedErrors([&]() { results[0] = loadPoints<DoubleKernel>(path(name), sequential); });
+		errors[1] = capturedErrors([&]() { results[1] = loadPoints<DoubleKernel>(path(name), parallel, &pool); });
+		const std::string line = std::string("line ") + ((name[0] == 'l') ? std::to_string(lateLine) : "4");
+		check(results[0] == -1 && results[1] == -1 && errors[0] == errors[1] && errors[0].find(line + ":") != std::string::npos,
+			(std::string("same line number of a syntax error ") + name + " in the text").c_str());
+	}
+}
+
+int main()
+{
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if (ec) {
+		fprintf(stderr, "Cannot create %s\n", directory.c_str());
+		return 1;
+	}
+	testBinaryPolygon();
+	testQuantizedPolygon();
+	testMultiPolygon();
+	testMeshSnapshot();
+	testParallelText();
+	std::filesystem::remove_all(directory, ec);
+
+	printf("%s\n", nFailed == 0 ? "All checks passed" : "Some checks FAILED");
+	return nFailed == 0 ? 0 : 1;
+}